@@ -1,78 +1,186 @@
+#include <algorithm>
+#include <iostream>
+#include "TFile.h"
+#include "TLeaf.h"
+#include "TTreeCache.h"
 #include "NuisTree.h"
+#include "particlecolumns.h"
 
 
 NuisTree::NuisTree(TTree *intree):
   tr(intree)
   {
-    tr->SetBranchAddress("Mode",&Mode);
-    tr->SetBranchAddress("PDGnu",&PDGnu);
-    tr->SetBranchAddress("cc",&iscc);
-    tr->SetBranchAddress("tgt",&tgt);
-    tr->SetBranchAddress("tgta",&tgta);
-    tr->SetBranchAddress("tgtz",&tgtz);
-    tr->SetBranchAddress("Enu_true",&Enu_true);
-    tr->SetBranchAddress("PDGLep",&PDGLep);
-    tr->SetBranchAddress("ELep",&ELep);
-    tr->SetBranchAddress("CosLep",&CosLep);
-    tr->SetBranchAddress("CosThetaAdler",&CosThetaAdler);
-    tr->SetBranchAddress("PhiAdler",&PhiAdler);
-    tr->SetBranchAddress("dalphat",&dalphat);
-    tr->SetBranchAddress("dpt",&dpt);
-    tr->SetBranchAddress("dphit",&dphit);
-    tr->SetBranchAddress("Q2",&Q2);
-    tr->SetBranchAddress("q0",&q0);
-    tr->SetBranchAddress("q3",&q3);
-    tr->SetBranchAddress("Enu_QE",&Enu_QE);
-    tr->SetBranchAddress("Q2_QE",&Q2_QE);
-    tr->SetBranchAddress("W_nuc_rest",&W_nuc_rest);
-    tr->SetBranchAddress("W",&W);
-    tr->SetBranchAddress("W_genie",&W_genie);
-    tr->SetBranchAddress("x",&x);
-    tr->SetBranchAddress("y",&y);
-    tr->SetBranchAddress("Eav",&Eav);
-    tr->SetBranchAddress("EavAlt",&EavAlt);
-    tr->SetBranchAddress("pnreco_C",&pnreco_c);
-    tr->SetBranchAddress("nfsp",&nfsp);
-    tr->SetBranchAddress("px",&fsp_px);
-    tr->SetBranchAddress("py",&fsp_py);
-    tr->SetBranchAddress("pz",&fsp_pz);
-    tr->SetBranchAddress("E",&fsp_E);
-    tr->SetBranchAddress("pdg",&fsp_pdg);
-    tr->SetBranchAddress("pdg_rank",&fsp_pdg_rank);
-    tr->SetBranchAddress("ninitp",&ninitp);
-    tr->SetBranchAddress("px_init",&initp_px);
-    tr->SetBranchAddress("py_init",&initp_py);
-    tr->SetBranchAddress("pz_init",&initp_pz);
-    tr->SetBranchAddress("E_init",&initp_E);
-    tr->SetBranchAddress("pdg_init",&initp_pdg);
-    tr->SetBranchAddress("nvertp",&nvertp);
-    tr->SetBranchAddress("px_vert",&vertp_px);
-    tr->SetBranchAddress("py_vert",&vertp_py);
-    tr->SetBranchAddress("pz_vert",&vertp_pz);
-    tr->SetBranchAddress("E_vert",&vertp_E);
-    tr->SetBranchAddress("pdg_vert",&vertp_pdg);
-    tr->SetBranchAddress("Weight",&Weight);
-    tr->SetBranchAddress("InputWeight",&InputWeight);
-    tr->SetBranchAddress("RWWeight",&RWWeight);
-    tr->SetBranchAddress("CustomWeight",&CustomWeight);
-    tr->SetBranchAddress("CustomWeightArray",&CustomWeightArray);
-    tr->SetBranchAddress("fScaleFactor",&fScaleFactor);
-    tr->SetBranchAddress("flagCCINC",&flagCCINC);
-    tr->SetBranchAddress("flagNCINC",&flagNCINC);
-    tr->SetBranchAddress("flagCCQE",&flagCCQE);
-    tr->SetBranchAddress("flagCC0pi",&flagCC0pi);
-    tr->SetBranchAddress("flagCC0piMINERvA",&flagCC0piMINERvA);
-    tr->SetBranchAddress("flagCCQELike",&flagCCQELike);
-    tr->SetBranchAddress("flagNCEL",&flagNCEL);
-    tr->SetBranchAddress("flagNC0pi",&flagNC0pi);
-    tr->SetBranchAddress("flagCCcoh",&flagCCcoh);
-    tr->SetBranchAddress("flagNCcoh",&flagNCcoh);
-    tr->SetBranchAddress("flagCC1pip",&flagCC1pip);
-    tr->SetBranchAddress("flagNC1pip",&flagNC1pip);
-    tr->SetBranchAddress("flagCC1pim",&flagCC1pim);
-    tr->SetBranchAddress("flagNC1pim",&flagNC1pim);
-    tr->SetBranchAddress("flagCC1pi0",&flagCC1pi0);
-    tr->SetBranchAddress("flagNC1pi0",&flagNC1pi0);
+    UseBuffers();
+    SetBranch("Mode",&Mode);
+    SetBranch("PDGnu",&PDGnu);
+    SetBranch("cc",&iscc);
+    SetBranch("tgt",&tgt);
+    SetBranch("tgta",&tgta);
+    SetBranch("tgtz",&tgtz);
+    SetBranch("Enu_true",&Enu_true);
+    SetBranch("PDGLep",&PDGLep);
+    SetBranch("ELep",&ELep);
+    SetBranch("CosLep",&CosLep);
+    SetBranch("CosThetaAdler",&CosThetaAdler);
+    SetBranch("PhiAdler",&PhiAdler);
+    SetBranch("dalphat",&dalphat);
+    SetBranch("dpt",&dpt);
+    SetBranch("dphit",&dphit);
+    SetBranch("Q2",&Q2);
+    SetBranch("q0",&q0);
+    SetBranch("q3",&q3);
+    SetBranch("Enu_QE",&Enu_QE);
+    SetBranch("Q2_QE",&Q2_QE);
+    SetBranch("W_nuc_rest",&W_nuc_rest);
+    SetBranch("W",&W);
+    SetBranch("W_genie",&W_genie);
+    SetBranch("x",&x);
+    SetBranch("y",&y);
+    SetBranch("Eav",&Eav);
+    SetBranch("EavAlt",&EavAlt);
+    SetBranch("pnreco_C",&pnreco_c);
+    SetBranch("nfsp",&nfsp);
+    SetBranch("px",fsp_px_buf);
+    SetBranch("py",fsp_py_buf);
+    SetBranch("pz",fsp_pz_buf);
+    SetBranch("E",fsp_E_buf);
+    SetBranch("pdg",fsp_pdg_buf);
+    SetBranch("pdg_rank",fsp_pdg_rank_buf);
+    SetBranch("ninitp",&ninitp);
+    SetBranch("px_init",initp_px_buf);
+    SetBranch("py_init",initp_py_buf);
+    SetBranch("pz_init",initp_pz_buf);
+    SetBranch("E_init",initp_E_buf);
+    SetBranch("pdg_init",initp_pdg_buf);
+    SetBranch("nvertp",&nvertp);
+    SetBranch("px_vert",vertp_px_buf);
+    SetBranch("py_vert",vertp_py_buf);
+    SetBranch("pz_vert",vertp_pz_buf);
+    SetBranch("E_vert",vertp_E_buf);
+    SetBranch("pdg_vert",vertp_pdg_buf);
+    SetBranch("Weight",&Weight);
+    SetBranch("InputWeight",&InputWeight);
+    SetBranch("RWWeight",&RWWeight);
+    SetBranch("CustomWeight",&CustomWeight);
+    SetBranch("CustomWeightArray",CustomWeightArray_buf);
+    SetBranch("fScaleFactor",&fScaleFactor);
+    SetBranch("flagCCINC",&flagCCINC);
+    SetBranch("flagNCINC",&flagNCINC);
+    SetBranch("flagCCQE",&flagCCQE);
+    SetBranch("flagCC0pi",&flagCC0pi);
+    SetBranch("flagCC0piMINERvA",&flagCC0piMINERvA);
+    SetBranch("flagCCQELike",&flagCCQELike);
+    SetBranch("flagNCEL",&flagNCEL);
+    SetBranch("flagNC0pi",&flagNC0pi);
+    SetBranch("flagCCcoh",&flagCCcoh);
+    SetBranch("flagNCcoh",&flagNCcoh);
+    SetBranch("flagCC1pip",&flagCC1pip);
+    SetBranch("flagNC1pip",&flagNC1pip);
+    SetBranch("flagCC1pim",&flagCC1pim);
+    SetBranch("flagNC1pim",&flagNC1pim);
+    SetBranch("flagCC1pi0",&flagCC1pi0);
+    SetBranch("flagNC1pi0",&flagNC1pi0);
+};
+
+void NuisTree::UseBuffers(){
+  fsp_px = fsp_px_buf;
+  fsp_py = fsp_py_buf;
+  fsp_pz = fsp_pz_buf;
+  fsp_E = fsp_E_buf;
+  fsp_pdg = fsp_pdg_buf;
+  fsp_pdg_rank = fsp_pdg_rank_buf;
+  fsp_p = fsp_p_buf;
+  fsp_ke = fsp_ke_buf;
+  fsp_costheta = fsp_costheta_buf;
+  fsp_phi = fsp_phi_buf;
+  initp_px = initp_px_buf;
+  initp_py = initp_py_buf;
+  initp_pz = initp_pz_buf;
+  initp_E = initp_E_buf;
+  initp_pdg = initp_pdg_buf;
+  vertp_px = vertp_px_buf;
+  vertp_py = vertp_py_buf;
+  vertp_pz = vertp_pz_buf;
+  vertp_E = vertp_E_buf;
+  vertp_pdg = vertp_pdg_buf;
+  CustomWeightArray = CustomWeightArray_buf;
+};
+
+void NuisTree::ComputeDerived(){
+  DeriveParticleColumns(nfsp, fsp_pdg, fsp_E, fsp_px, fsp_py, fsp_pz,
+                        fsp_p_buf, fsp_ke_buf, fsp_costheta_buf, fsp_phi_buf);
+};
+
+void NuisTree::SetBranch(const char* name, void* addr){
+  tr->SetBranchAddress(name,addr);
+  branches.push_back(name);
+};
+
+void NuisTree::DisableBranch(const char* name){
+  tr->SetBranchStatus(name,0);
+};
+
+void NuisTree::SetupCache(Long64_t cachesize){
+  std::vector<std::string> active;
+  Long64_t zipbytes = 0;
+  for (const std::string& name : branches){
+    TBranch *b = tr->GetBranch(name.c_str());
+    if (!b || !tr->GetBranchStatus(name.c_str())) continue;
+    active.push_back(name);
+    zipbytes += b->GetZipBytes();
+  }
+
+  if (cachesize <= 0){
+    // One cluster of the active branches (assuming clusters are roughly equal in size), with headroom for uneven baskets
+    Long64_t nclusters = std::max<Long64_t>(GetClusters().size(),1);
+    cachesize = std::max<Long64_t>(2*zipbytes/nclusters, 1<<20);
+  }
+
+  tr->SetCacheSize(cachesize);
+
+  // Skip the learning phase: we already know which branches are read, and letting the cache learn would also pick up branches touched only by the first few entries
+  for (const std::string& name : active){
+    tr->AddBranchToCache(name.c_str(),true);
+  }
+  tr->StopCacheLearningPhase();
+
+  std::cout << "CACHE " << cachesize << " bytes for " << active.size() << "/" << branches.size() << " branches" << std::endl;
+};
+
+std::vector<std::pair<Long64_t, Long64_t> > NuisTree::GetClusters() const{
+  return GetClusters(tr);
+};
+
+std::vector<std::pair<Long64_t, Long64_t> > NuisTree::GetClusters(TTree *intree){
+  std::vector<std::pair<Long64_t, Long64_t> > clusters;
+  Long64_t nentries = intree->GetEntries();
+  TTree::TClusterIterator it = intree->GetClusterIterator(0);
+  Long64_t first;
+  while ((first = it()) < nentries){
+    clusters.push_back(std::make_pair(first,std::min(it.GetNextEntry(),nentries)));
+  }
+  return clusters;
+};
+
+int NuisTree::GetArrayLength(TTree *intree, const char* name){
+  TLeaf *leaf = intree->GetLeaf(name);
+  if (!leaf) return 0;
+  TLeaf *count = leaf->GetLeafCount();
+  return count ? leaf->GetLenStatic() * count->GetMaximum() : leaf->GetLenStatic();
+};
+
+void NuisTree::PrintCacheStats() const{
+  if (!tr) return;
+  TFile *f = tr->GetCurrentFile();
+  if (!f) return;
+  TTreeCache *cache = dynamic_cast<TTreeCache*>(f->GetCacheRead(tr));
+  if (cache){
+    std::cout << "CACHE hit efficiency " << cache->GetEfficiency()
+              << " (relative " << cache->GetEfficiencyRel() << "), miss efficiency "
+              << cache->GetMissEfficiency() << " (relative " << cache->GetMissEfficiencyRel() << ")" << std::endl;
+  }
+  std::cout << "CACHE " << f->GetReadCalls() << " read calls, "
+            << f->GetBytesRead() << " bytes read from " << f->GetName() << std::endl;
 };
 
 int NuisTree::GetCCNCEnum() const{
@@ -84,11 +192,16 @@ int NuisTree::GetCCNCEnum() const{
 
 
 int NuisTree::GetGENIEMode() const{
+  return GetGENIEMode(Mode);
+};
+
+
+int NuisTree::GetGENIEMode(int mode){
   // References:
   // 1) NEUT mode description (used by NUISANCE) http://wng.ift.uni.wroc.pl/karp45/software/NeutUsage.pdf
   // 2) GENIE->NEUT translation https://github.com/GENIE-MC/Generator/blob/master/src/Framework/GHEP/GHepUtils.cxx#L30
   // 3) NUISANCE modes https://github.com/NUISANCEMC/nuisance/blob/master/src/InputHandler/InteractionModes.h
-  switch(Mode){
+  switch(mode){
     case 1: // NUISANCE kCCQE = 1
     case 51: // NUISANCE kNCELonp = 51
     case 52: // NUISANCE kNCELonn = 52
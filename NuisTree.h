@@ -1,6 +1,9 @@
 #ifndef __NUISTREE_H__
 #define __NUISTREE_H__
 
+#include <string>
+#include <utility>
+#include <vector>
 #include "TTree.h"
 #include "TLorentzVector.h"
 #include "enums.h"
@@ -8,13 +11,37 @@
 class NuisTree{
 public:
 	NuisTree(TTree *intree);
+  NuisTree() : tr(nullptr) {UseBuffers();}; // for events from other sources (e.g. an EventStore), which set the fields directly
+  NuisTree(const NuisTree&) = delete; // the stack pointers may point into our own buffers
 	~NuisTree() {};
 
-  int GetEntries(){return tr->GetEntries();};
-  bool GetEntry(int i){return tr->GetEntry(i);};
+  Long64_t GetEntries(){return tr->GetEntries();};
+  bool GetEntry(Long64_t i){bool ok = tr->GetEntry(i); ComputeDerived(); return ok;};
+
+  // Fill the derived fsp columns from the current stack. Called by GetEntry; sources that set the fields directly call it themselves
+  void ComputeDerived();
+
+  // Switch off branches that no filter or distribution reads (wildcards allowed, e.g. "*_vert")
+  void DisableBranch(const char* name);
+
+  // Set up a TTreeCache over the active branches. With cachesize <= 0 the cache is sized to hold one cluster's worth of them
+  void SetupCache(Long64_t cachesize=0);
+
+  // Entry ranges [first, last) of the tree's clusters, so reads can follow basket boundaries
+  std::vector<std::pair<Long64_t, Long64_t> > GetClusters() const;
+  static std::vector<std::pair<Long64_t, Long64_t> > GetClusters(TTree *intree);
+
+  // Length of an array branch: its declared length, or the largest count of a variable-length array; 0 if the tree has no such leaf
+  static int GetArrayLength(TTree *intree, const char* name);
+
+  static constexpr int kMaxArray = 9999; // Elements held by each array branch buffer
+
+  // Report TTreeCache hit/miss efficiency and file read calls
+  void PrintCacheStats() const;
 
   int GetCCNCEnum() const;
   int GetGENIEMode() const;
+  static int GetGENIEMode(int mode); // GENIE interaction type (enums::int_type_genie) for a NUISANCE mode
 
   int Mode;
   int PDGnu;
@@ -45,12 +72,18 @@ public:
   float EavAlt;
   float pnreco_c;
   int nfsp;
-  float fsp_px[9999];
-  float fsp_py[9999];
-  float fsp_pz[9999];
-  float fsp_E[9999];
-  int fsp_pdg[9999];
-  int fsp_pdg_rank[9999];
+  // Particle stacks are pointers rather than arrays, so that stores in memory can be read without copying
+  const float *fsp_px;
+  const float *fsp_py;
+  const float *fsp_pz;
+  const float *fsp_E;
+  const int *fsp_pdg;
+  const int *fsp_pdg_rank;
+  // Derived per-particle columns (particlecolumns.h), computed once per event by ComputeDerived
+  const float *fsp_p; // momentum magnitude
+  const float *fsp_ke; // kinetic energy
+  const float *fsp_costheta; // cos(theta) with respect to z
+  const float *fsp_phi; // azimuthal angle
   // std::vector<float> *fsp_px=nullptr;
   // std::vector<float> *fsp_py=nullptr;
   // std::vector<float> *fsp_pz=nullptr;
@@ -58,22 +91,22 @@ public:
   // std::vector<int> *fsp_pdg=nullptr;
   // std::vector<int> *fsp_pdg_rank=nullptr;
   int ninitp;
-  float initp_px[9999];
-  float initp_py[9999];
-  float initp_pz[9999];
-  float initp_E[9999];
-  int initp_pdg[9999];
+  const float *initp_px;
+  const float *initp_py;
+  const float *initp_pz;
+  const float *initp_E;
+  const int *initp_pdg;
   // std::vector<float> *initp_px=nullptr;
   // std::vector<float> *initp_py=nullptr;
   // std::vector<float> *initp_pz=nullptr;
   // std::vector<float> *initp_E=nullptr;
   // std::vector<int> *initp_pdg=nullptr;
   int nvertp;
-  float vertp_px[9999];
-  float vertp_py[9999];
-  float vertp_pz[9999];
-  float vertp_E[9999];
-  int vertp_pdg[9999];
+  const float *vertp_px;
+  const float *vertp_py;
+  const float *vertp_pz;
+  const float *vertp_E;
+  const int *vertp_pdg;
   // std::vector<float> *vertp_px=nullptr;
   // std::vector<float> *vertp_py=nullptr;
   // std::vector<float> *vertp_pz=nullptr;
@@ -83,7 +116,7 @@ public:
   float InputWeight;
   float RWWeight;
   float CustomWeight;
-  float CustomWeightArray[9999];
+  const float *CustomWeightArray;
   double fScaleFactor;
   bool flagCCINC;
   bool flagNCINC;
@@ -104,7 +137,34 @@ public:
 
 
 private:
+  void SetBranch(const char* name, void* addr);
+  void UseBuffers();
+
+  // Branch buffers. The public stack pointers point here when reading from a TTree, or straight into an EventStore's columns
+  float fsp_px_buf[kMaxArray];
+  float fsp_py_buf[kMaxArray];
+  float fsp_pz_buf[kMaxArray];
+  float fsp_E_buf[kMaxArray];
+  int fsp_pdg_buf[kMaxArray];
+  int fsp_pdg_rank_buf[kMaxArray];
+  float fsp_p_buf[kMaxArray];
+  float fsp_ke_buf[kMaxArray];
+  float fsp_costheta_buf[kMaxArray];
+  float fsp_phi_buf[kMaxArray];
+  float initp_px_buf[kMaxArray];
+  float initp_py_buf[kMaxArray];
+  float initp_pz_buf[kMaxArray];
+  float initp_E_buf[kMaxArray];
+  int initp_pdg_buf[kMaxArray];
+  float vertp_px_buf[kMaxArray];
+  float vertp_py_buf[kMaxArray];
+  float vertp_pz_buf[kMaxArray];
+  float vertp_E_buf[kMaxArray];
+  int vertp_pdg_buf[kMaxArray];
+  float CustomWeightArray_buf[kMaxArray];
+
   TTree *tr;
+  std::vector<std::string> branches; // names of all bound branches
 };
 
 #endif
@@ -0,0 +1,132 @@
+/**
+ * Benchmark the kinematics kernels: fourvector.h against TLorentzVector
+ * and TVector3.
+ *
+ * Generates random lepton/particle pairs and times the operations used in
+ * the fills (invariant mass W, cos(theta), the cosine of the opening angle,
+ * and delta phi) with each implementation, printing the time per call and
+ * the largest difference between the two.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "TLorentzVector.h"
+#include "TVector3.h"
+#include "fourvector.h"
+
+namespace {
+
+  struct Momenta {
+    std::vector<float> E, px, py, pz;
+  };
+
+  // Random massive particles with |p| < 2 GeV
+  Momenta Generate(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1, 1);
+    Momenta m;
+    for (size_t i=0; i<n; i++) {
+      float px = 2 * u(rng), py = 2 * u(rng), pz = 2 * u(rng);
+      m.px.push_back(px);
+      m.py.push_back(py);
+      m.pz.push_back(pz);
+      m.E.push_back(std::sqrt(px * px + py * py + pz * pz + 0.938f * 0.938f));
+    }
+    return m;
+  }
+
+  // Time one kernel over all pairs; results go to out. Returns ns per call.
+  template <class F>
+  double Time(size_t n, std::vector<double>& out, F f) {
+    out.resize(n);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i=0; i<n; i++) {
+      out[i] = f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n;
+  }
+
+  double MaxDiff(const std::vector<double>& a, const std::vector<double>& b) {
+    double d = 0;
+    for (size_t i=0; i<a.size(); i++) {
+      d = std::max(d, std::abs(a[i] - b[i]));
+    }
+    return d;
+  }
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  size_t n = argc > 1 ? std::atol(argv[1]) : 10000000;
+
+  Momenta a = Generate(n, 1);
+  Momenta b = Generate(n, 2);
+
+  std::vector<double> root, fast;
+  std::cout << "kernel      ROOT (ns)   fourvector (ns)   max |diff|" << std::endl;
+
+  auto report = [&](const char* name, double troot, double tfast) {
+    std::cout << name << "\t" << troot << "\t\t" << tfast << "\t\t" << MaxDiff(root, fast) << std::endl;
+  };
+
+  // W from the sum of two four-momenta
+  {
+    double troot = Time(n, root, [&](size_t i) {
+      TLorentzVector p(a.px[i], a.py[i], a.pz[i], a.E[i]);
+      TLorentzVector q(b.px[i], b.py[i], b.pz[i], b.E[i]);
+      return (p + q).M();
+    });
+    double tfast = Time(n, fast, [&](size_t i) {
+      FourVectorD p{a.px[i], a.py[i], a.pz[i], a.E[i]};
+      FourVectorD q{b.px[i], b.py[i], b.pz[i], b.E[i]};
+      return (p + q).M();
+    });
+    report("W       ", troot, tfast);
+  }
+
+  // cos(theta)
+  {
+    double troot = Time(n, root, [&](size_t i) {
+      return std::cos(TVector3(a.px[i], a.py[i], a.pz[i]).Theta());
+    });
+    double tfast = Time(n, fast, [&](size_t i) {
+      return Vector3F{a.px[i], a.py[i], a.pz[i]}.CosTheta();
+    });
+    report("CosTheta", troot, tfast);
+  }
+
+  // Cosine of the opening angle
+  {
+    double troot = Time(n, root, [&](size_t i) {
+      TVector3 p(a.px[i], a.py[i], a.pz[i]);
+      return std::cos(p.Angle(TVector3(b.px[i], b.py[i], b.pz[i])));
+    });
+    double tfast = Time(n, fast, [&](size_t i) {
+      Vector3F p{a.px[i], a.py[i], a.pz[i]};
+      return p.CosAngle(Vector3F{b.px[i], b.py[i], b.pz[i]});
+    });
+    report("CosAngle", troot, tfast);
+  }
+
+  // Delta phi
+  {
+    double troot = Time(n, root, [&](size_t i) {
+      TVector3 p(a.px[i], a.py[i], a.pz[i]);
+      return p.DeltaPhi(TVector3(b.px[i], b.py[i], b.pz[i]));
+    });
+    double tfast = Time(n, fast, [&](size_t i) {
+      Vector3F p{a.px[i], a.py[i], a.pz[i]};
+      return p.DeltaPhi(Vector3F{b.px[i], b.py[i], b.pz[i]});
+    });
+    report("DeltaPhi", troot, tfast);
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include "TH1.h"
+#include "binarena.h"
+#include "distributions.h"
+
+namespace {
+
+  size_t RoundUp(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+  }
+
+}  // namespace
+
+
+BinArena::~BinArena() {
+  std::free(block);
+}
+
+
+void BinArena::Attach(const std::vector<Distribution*>& dists) {
+  if (block) {
+    throw std::logic_error("BinArena: already attached");
+  }
+
+  // Expand groups into their members
+  std::vector<Distribution*> parts;
+  for (Distribution* dist : dists) {
+    distributions::MultGroup* group = dynamic_cast<distributions::MultGroup*>(dist);
+    if (group) {
+      parts.insert(parts.end(), group->mults.begin(), group->mults.end());
+    }
+    else {
+      parts.push_back(dist);
+    }
+  }
+
+  // Layout: the fill counts, then each distribution's cells, then each
+  // distribution's weight channels, every segment starting on a cache line
+  const size_t perline = kAlign / sizeof(BinSums::Bin);
+  const size_t channelsperline = kAlign / sizeof(double);
+  std::vector<size_t> offsets;
+  std::vector<size_t> channeloffsets;
+  nbins = 0;
+  nchannels = 0;
+  for (Distribution* dist : parts) {
+    offsets.push_back(nbins);
+    nbins += RoundUp(dist->hist->GetNcells(), perline);
+    channeloffsets.push_back(nchannels);
+    nchannels += RoundUp(dist->ChannelSize(), channelsperline);
+  }
+  nsegments = parts.size();
+  size_t head = RoundUp(nsegments * sizeof(double), kAlign);
+  bytes = head + nbins * sizeof(BinSums::Bin) + nchannels * sizeof(double);
+
+  block = (char*)std::aligned_alloc(kAlign, RoundUp(std::max(bytes, kAlign), kAlign));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  entries = (double*)block;
+  bins = (BinSums::Bin*)(block + head);
+  channels = (double*)(bins + nbins);
+  Clear();
+
+  for (size_t i=0; i<parts.size(); i++) {
+    parts[i]->UseSums(bins + offsets[i], entries + i);
+    if (parts[i]->ChannelSize() > 0) {
+      parts[i]->UseChannels(channels + channeloffsets[i]);
+    }
+  }
+}
+
+
+void BinArena::Clear() {
+  if (block) {
+    std::memset(block, 0, bytes);
+  }
+}
+
+
+void BinArena::Merge(const BinArena& other) {
+  if (other.nbins != nbins || other.nchannels != nchannels || other.nsegments != nsegments) {
+    throw std::invalid_argument("BinArena: layout mismatch");
+  }
+  for (size_t i=0; i<nsegments; i++) {
+    entries[i] += other.entries[i];
+  }
+  BinSums::Merge(bins, other.bins, nbins);
+  for (size_t i=0; i<nchannels; i++) {
+    channels[i] += other.channels[i];
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef __BINARENA__
+#define __BINARENA__
+
+/**
+ * One contiguous block for the fill-time sums of a set of distributions.
+ *
+ * Left to themselves, the distributions allocate their sums (BinSums, on
+ * first fill) and weight channel buffers (WeightChannels, the largest with
+ * universes, replicas or slices) one by one, scattered over the heap. A
+ * BinArena lays out both for every distribution in a set in a single
+ * cache-line-aligned block, in the order they are given (e.g. grouped by
+ * filter, as the event loop visits them): all the sums a thread fills are
+ * one allocation, zeroed with one memset, and merging two replicas is one
+ * linear pass. The histograms themselves (which only receive the sums when
+ * written) and the Distribution objects are allocated separately.
+ */
+
+#include <cstddef>
+#include <vector>
+#include "binsums.h"
+
+struct Distribution;
+
+/**
+ * \class BinArena
+ * \brief Owns the BinSums cells and weight channels of a set of distributions.
+ *
+ * Distributions keep their own sums and channels objects, as views into
+ * the arena. These are merged with the whole arena, not by
+ * Distribution::Merge.
+ */
+class BinArena {
+public:
+  BinArena() : block(nullptr), bytes(0), entries(nullptr), bins(nullptr), channels(nullptr),
+               nbins(0), nchannels(0), nsegments(0) {}
+
+  ~BinArena();
+
+  BinArena(const BinArena&) = delete;
+  BinArena& operator=(const BinArena&) = delete;
+
+  /**
+   * Allocate the block and point each distribution's sums and channels
+   * into it, in order. Groups (e.g. MultSet) contribute each of their
+   * members. Call once, after EnableChannels and before filling.
+   */
+  void Attach(const std::vector<Distribution*>& dists);
+
+  /** Zero all sums. */
+  void Clear();
+
+  /** Add the sums of another arena with the same layout. */
+  void Merge(const BinArena& other);
+
+  /** Size of the block (bytes). */
+  size_t GetSize() const { return bytes; }
+
+private:
+  static constexpr size_t kAlign = 64;  //!< Segment alignment (a cache line)
+
+  char* block;  //!< The block
+  size_t bytes;  //!< Block size
+  double* entries;  //!< Fill counts, one per segment
+  BinSums::Bin* bins;  //!< Cells of all segments
+  double* channels;  //!< Weight channel sums of all segments
+  size_t nbins;  //!< Number of cells, including padding
+  size_t nchannels;  //!< Number of channel sums, including padding
+  size_t nsegments;  //!< Number of distributions
+};
+
+#endif  // __BINARENA__
@@ -0,0 +1,27 @@
+#include <cmath>
+#include "TH1.h"
+#include "binsums.h"
+
+void BinSums::Merge(const BinSums& other) {
+  Merge(bins, other.bins, nbins);
+  *nentries += *other.nentries;
+}
+
+
+void BinSums::Merge(Bin* a, const Bin* b, size_t n) {
+  for (size_t i=0; i<n; i++) {
+    Add(a[i].sumw, a[i].cw, b[i].sumw);
+    Add(a[i].sumw2, a[i].cw2, b[i].sumw2);
+    a[i].cw += b[i].cw;
+    a[i].cw2 += b[i].cw2;
+  }
+}
+
+
+void BinSums::Copy(TH1* hist) const {
+  for (size_t i=0; i<nbins; i++) {
+    hist->SetBinContent(i, bins[i].sumw + bins[i].cw);
+    hist->SetBinError(i, std::sqrt(bins[i].sumw2 + bins[i].cw2));
+  }
+  hist->SetEntries(*nentries);
+}
@@ -0,0 +1,103 @@
+#ifndef __BINSUMS__
+#define __BINSUMS__
+
+/**
+ * Compensated per-bin sums of weights.
+ *
+ * TH1F/TH2F keep their bin contents as 32-bit floats, so once a bin holds
+ * ~1e7 weighted entries further small weights are rounded away. The
+ * distributions instead add their fills to BinSums, in double precision
+ * with Kahan-Babuska (Neumaier) compensation, and copy the sums into the
+ * histogram only when it is written. The output files keep their types.
+ *
+ * The sums either own their cells or are a view into a BinArena, which
+ * holds the cells of many distributions in one block.
+ */
+
+#include <cmath>
+#include <vector>
+
+class TH1;
+
+/**
+ * \class BinSums
+ * \brief Compensated sums of w and w^2 for each cell of a histogram.
+ *
+ * \param _nbins Number of histogram cells (including under/overflow)
+ */
+class BinSums {
+public:
+  /** One cell: sums and their running compensations. */
+  struct Bin {
+    double sumw;  //!< Sum of weights
+    double cw;  //!< Compensation for sumw
+    double sumw2;  //!< Sum of squared weights
+    double cw2;  //!< Compensation for sumw2
+  };
+
+  /** Sums owning their cells. */
+  BinSums(size_t _nbins)
+      : storage(_nbins, Bin{0, 0, 0, 0}), bins(storage.data()), nbins(_nbins),
+        nentries(&ownentries), ownentries(0), inarena(false) {}
+
+  /**
+   * Sums in external storage (zeroed by the owner), e.g. a BinArena.
+   *
+   * \param _bins The cells
+   * \param _nbins Number of cells
+   * \param _nentries Where to count fills
+   */
+  BinSums(Bin* _bins, size_t _nbins, double* _nentries)
+      : bins(_bins), nbins(_nbins), nentries(_nentries), ownentries(0), inarena(true) {}
+
+  /** Copy, into owned cells. */
+  BinSums(const BinSums& other)
+      : storage(other.bins, other.bins + other.nbins), bins(storage.data()),
+        nbins(other.nbins), nentries(&ownentries), ownentries(*other.nentries),
+        inarena(false) {}
+
+  BinSums& operator=(const BinSums&) = delete;
+
+  /** Add a weight to a cell. */
+  void Fill(int bin, double w) {
+    Bin& b = bins[bin];
+    Add(b.sumw, b.cw, w);
+    Add(b.sumw2, b.cw2, w * w);
+    (*nentries)++;
+  }
+
+  /** Add the sums of another copy. */
+  void Merge(const BinSums& other);
+
+  /** Add n cells of sums b to a, compensated. */
+  static void Merge(Bin* a, const Bin* b, size_t n);
+
+  /** Number of fills. */
+  double GetEntries() const { return *nentries; }
+
+  /** True if the cells are held by a BinArena. */
+  bool InArena() const { return inarena; }
+
+  /**
+   * Set the contents and errors of a histogram with the same cells to the
+   * sums (the only point where they are rounded to the histogram's type).
+   */
+  void Copy(TH1* hist) const;
+
+private:
+  /** Neumaier's compensated addition of x to s, tracking the lost low-order part in c. */
+  static void Add(double& s, double& c, double x) {
+    double t = s + x;
+    c += (std::fabs(s) >= std::fabs(x)) ? (s - t) + x : (x - t) + s;
+    s = t;
+  }
+
+  std::vector<Bin> storage;  //!< Owned cells (empty for external storage)
+  Bin* bins;  //!< Sums, per cell
+  size_t nbins;  //!< Number of cells
+  double* nentries;  //!< Number of fills
+  double ownentries;  //!< Fill count, for owned cells
+  bool inarena;  //!< Cells are in external storage
+};
+
+#endif  // __BINSUMS__
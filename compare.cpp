@@ -0,0 +1,61 @@
+/**
+ * Overlay the histograms of several plotter outputs (see overlay.h).
+ *
+ * Each input is read once, up front, and the plots are rendered in
+ * parallel.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TH1.h"
+#include "TStyle.h"
+#include "overlay.h"
+
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  bool normalize = false;
+  size_t nworkers = std::thread::hardware_concurrency();
+  std::vector<std::string> filenames;
+  std::vector<std::string> titles;
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n") {
+      normalize = true;
+    }
+    else if (arg == "-j" && i+1 < argc) {
+      nworkers = std::atoi(argv[++i]);
+    }
+    else {
+      args.push_back(arg);
+    }
+  }
+  for (size_t i=0; i+1<args.size(); i+=2) {
+    filenames.push_back(args[i]);
+    titles.push_back(args[i+1]);
+  }
+
+  if (filenames.size() < 2 || args.size() % 2 != 0) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "[-n] [-j NWORKERS] INPUT1.root TITLE1 INPUT2.root TITLE2 [INPUT3.root TITLE3 ...]" << std::endl
+              << "  -n  Area-normalize the histograms" << std::endl
+              << "  -j  Number of rendering processes (default: one per core)" << std::endl;
+    return 0;
+  }
+
+  gStyle->SetOptStat(0);
+  gStyle->SetPalette(kBird);
+  TH1::AddDirectory(false);
+
+  Samples samples;
+  if (!LoadSamples(filenames, titles, normalize, samples)) {
+    return 1;
+  }
+  RenderOverlays(samples, samples.names, nworkers);
+
+  return 0;
+}
@@ -0,0 +1,223 @@
+/**
+ * Rank the differences between plotter outputs, and draw only those that
+ * changed.
+ *
+ * Each histogram of every input is compared with the same histogram in the
+ * first (reference) input, over the in-range bins:
+ *
+ *   chi2/ndf  sum of (a - b)^2 / (da^2 + db^2) over bins with nonzero
+ *             error, divided by their number
+ *   KS        largest difference between the normalized cumulative
+ *             distributions (for 2D, over the bins in global order)
+ *   max pull  largest |a - b| / sqrt(da^2 + db^2)
+ *
+ * The comparisons run on a pool of threads, and the table of all of them,
+ * ranked by chi2/ndf, is written to a text file. With -t, the histograms
+ * with chi2/ndf above the threshold for any input are rendered as in
+ * compare (see overlay.h).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TH1.h"
+#include "TStyle.h"
+#include "overlay.h"
+
+namespace {
+
+  // Comparison of one histogram in one input with the reference
+  struct Diff {
+    std::string name;  // Histogram name
+    size_t sample;  // Input index
+    double chi2;
+    int ndf;
+    double ks;
+    double maxpull;
+    bool valid;  // False if the binnings differ
+  };
+
+  void Compare(const TH1* a, const TH1* b, Diff& d) {
+    d.chi2 = 0;
+    d.ndf = 0;
+    d.ks = 0;
+    d.maxpull = 0;
+    int nx = a->GetNbinsX();
+    int ny = a->GetDimension() > 1 ? a->GetNbinsY() : 1;
+    d.valid = b->GetNbinsX() == nx && (a->GetDimension() > 1 ? b->GetNbinsY() : 1) == ny;
+    if (!d.valid) {
+      return;
+    }
+
+    double suma = 0, sumb = 0;
+    for (int iy=1; iy<=ny; iy++) {
+      for (int ix=1; ix<=nx; ix++) {
+        int bin = a->GetDimension() > 1 ? a->GetBin(ix, iy) : ix;
+        suma += a->GetBinContent(bin);
+        sumb += b->GetBinContent(bin);
+      }
+    }
+
+    double cuma = 0, cumb = 0;
+    for (int iy=1; iy<=ny; iy++) {
+      for (int ix=1; ix<=nx; ix++) {
+        int bin = a->GetDimension() > 1 ? a->GetBin(ix, iy) : ix;
+        double ca = a->GetBinContent(bin);
+        double cb = b->GetBinContent(bin);
+        double ea = a->GetBinError(bin);
+        double eb = b->GetBinError(bin);
+        double var = ea * ea + eb * eb;
+        if (var > 0) {
+          d.chi2 += (ca - cb) * (ca - cb) / var;
+          d.ndf++;
+          d.maxpull = std::max(d.maxpull, std::fabs(ca - cb) / std::sqrt(var));
+        }
+        cuma += ca;
+        cumb += cb;
+        if (suma > 0 && sumb > 0) {
+          d.ks = std::max(d.ks, std::fabs(cuma / suma - cumb / sumb));
+        }
+      }
+    }
+    if ((suma > 0) != (sumb > 0)) {
+      d.ks = 1;
+    }
+  }
+
+  double Chi2NDF(const Diff& d) {
+    return d.ndf > 0 ? d.chi2 / d.ndf : 0;
+  }
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  bool normalize = false;
+  bool render = false;
+  double threshold = 0;
+  size_t nthreads = std::thread::hardware_concurrency();
+  std::string tablename = "diff_summary.txt";
+  std::vector<std::string> filenames;
+  std::vector<std::string> titles;
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n") {
+      normalize = true;
+    }
+    else if (arg == "-j" && i+1 < argc) {
+      nthreads = std::atoi(argv[++i]);
+    }
+    else if (arg == "-t" && i+1 < argc) {
+      render = true;
+      threshold = std::atof(argv[++i]);
+    }
+    else if (arg == "-o" && i+1 < argc) {
+      tablename = argv[++i];
+    }
+    else {
+      args.push_back(arg);
+    }
+  }
+  for (size_t i=0; i+1<args.size(); i+=2) {
+    filenames.push_back(args[i]);
+    titles.push_back(args[i+1]);
+  }
+
+  if (filenames.size() < 2 || args.size() % 2 != 0) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "[-n] [-j NTHREADS] [-t CHI2NDF] [-o TABLE.txt] REFERENCE.root TITLE1 INPUT2.root TITLE2 [INPUT3.root TITLE3 ...]" << std::endl
+              << "  -n  Compare shapes (area-normalize the histograms)" << std::endl
+              << "  -j  Number of threads and rendering processes (default: one per core)" << std::endl
+              << "  -t  Render the histograms with chi2/ndf above CHI2NDF for any input" << std::endl
+              << "  -o  Ranked table of the differences (default: diff_summary.txt)" << std::endl;
+    return 0;
+  }
+  nthreads = std::max<size_t>(1, nthreads);
+
+  gStyle->SetOptStat(0);
+  gStyle->SetPalette(kBird);
+  TH1::AddDirectory(false);
+
+  Samples samples;
+  if (!LoadSamples(filenames, titles, normalize, samples)) {
+    return 1;
+  }
+
+  // One comparison per histogram and non-reference input
+  std::vector<Diff> diffs;
+  for (const std::string& name : samples.names) {
+    for (size_t i=1; i<samples.hists.size(); i++) {
+      if (samples.hists[i].count(name)) {
+        diffs.push_back({ name, i, 0, 0, 0, 0, false });
+      }
+      else {
+        std::cout << "Warning: no " << name << " in " << filenames[i] << std::endl;
+      }
+    }
+  }
+
+  // Reading bin contents is thread-safe, so the comparisons run in parallel
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (size_t t=0; t<nthreads; t++) {
+    workers.emplace_back([&]() {
+      for (size_t j=next++; j<diffs.size(); j=next++) {
+        Diff& d = diffs[j];
+        Compare(samples.hists[0].at(d.name), samples.hists[d.sample].at(d.name), d);
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  // Rank by chi2/ndf; differing binnings first, as they need attention
+  std::stable_sort(diffs.begin(), diffs.end(), [](const Diff& a, const Diff& b) {
+    if (a.valid != b.valid) return !a.valid;
+    return Chi2NDF(a) > Chi2NDF(b);
+  });
+
+  std::ofstream table(tablename);
+  char line[512];
+  snprintf(line, sizeof(line), "%-5s %-50s %-20s %10s %6s %8s %9s",
+           "rank", "histogram", "input", "chi2/ndf", "ndf", "KS", "max pull");
+  table << line << std::endl;
+  for (size_t j=0; j<diffs.size(); j++) {
+    const Diff& d = diffs[j];
+    if (d.valid) {
+      snprintf(line, sizeof(line), "%-5zu %-50s %-20s %10.3f %6i %8.4f %9.2f",
+               j + 1, d.name.c_str(), titles[d.sample].c_str(), Chi2NDF(d), d.ndf, d.ks, d.maxpull);
+    }
+    else {
+      snprintf(line, sizeof(line), "%-5zu %-50s %-20s   binnings differ",
+               j + 1, d.name.c_str(), titles[d.sample].c_str());
+    }
+    table << line << std::endl;
+    if (j < 20) {
+      std::cout << line << std::endl;
+    }
+  }
+  std::cout << "WRITE " << tablename << " (" << diffs.size() << " comparisons)" << std::endl;
+
+  if (render) {
+    std::vector<std::string> changed;
+    for (const Diff& d : diffs) {
+      if ((!d.valid || Chi2NDF(d) > threshold) &&
+          std::find(changed.begin(), changed.end(), d.name) == changed.end()) {
+        changed.push_back(d.name);
+      }
+    }
+    RenderOverlays(samples, changed, nthreads);
+  }
+
+  return 0;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include "TCanvas.h"
@@ -6,10 +8,8 @@
 #include "TH1F.h"
 #include "TH2F.h"
 #include "TH3F.h"
-#include "TMath.h"
-#include "TVector3.h"
-#include "TLorentzVector.h"
 #include "distributions.h"
+#include "eventview.h"
 #include "filter.h"
 #include <iostream>
 
@@ -28,284 +28,374 @@ int IonPdgCodeToA(int ion_pdgc) {
 
 Distribution::Distribution(std::string _name, std::string _title,
              TH1* _hist, Filter* _filter)
-    : hist(_hist), filter(_filter), name(_name), title(_title) {}
+    : hist(_hist), filter(_filter), name(_name), title(_title), capture(nullptr),
+      weights(nullptr) {}
 
 
-void Distribution::Write() {
-  std::cout << "WRITE " << hist->GetName() << std::endl;
-  hist->Write();
+void Distribution::EnableChannels(const EventWeights* _weights) {
+  weights = _weights;
+  channels.reset(new WeightChannels(hist->GetNcells(), weights->size(), weights->NSlices()));
 }
 
 
-void Distribution::Save(TCanvas* c) {
-  bool own_canvas = c == NULL;
-  c = (c == NULL ? new TCanvas("c1", "", 500, 500) : c);
-  c->cd();
-  hist->Draw("colz");
-  c->SaveAs((std::string("hist_") + name + ".png").c_str());
-  if (own_canvas) delete c;
+void Distribution::FillHist(double x, double w) {
+  if (capture) {
+    capture[0] = x;
+    return;
+  }
+  if (!sums) {
+    sums.reset(new BinSums(hist->GetNcells()));
+  }
+  int bin = hist->FindFixBin(x);
+  sums->Fill(bin, w);
+  if (channels) {
+    channels->Fill(weights->slice, bin, weights->data());
+  }
 }
 
 
-namespace distributions {
-
-  Q2::Q2(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Q^{2}, ") + _filter->title;
-    std::string hname = "hq2_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Q^{2} (GeV^{2});Events").c_str(),
-                    20, 0, 2);
+void Distribution::FillHist(double x, double y, double w) {
+  if (capture) {
+    capture[0] = x;
+    capture[1] = y;
+    return;
   }
-
-  #ifdef __LARSOFT__
-  void Q2::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(truth.GetNeutrino().QSqr(), w);
+  if (!sums) {
+    sums.reset(new BinSums(hist->GetNcells()));
   }
-  #endif
-
-  void Q2::Fill(const NuisTree& nuistr){
-    dynamic_cast<TH1F*>(hist)->Fill(nuistr.Q2,nuistr.Weight);
+  int bin = hist->FindFixBin(x, y);
+  sums->Fill(bin, w);
+  if (channels) {
+    channels->Fill(weights->slice, bin, weights->data());
   }
+}
 
 
-  TheoristsW::TheoristsW(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Theorists W = sqrt(p.p + 2p.q - Q^2), ") + _filter->title;
-    std::string hname = "hthw_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Theorists W = sqrt(p.p + 2p.q - Q^2) (GeV);Events").c_str(),
-                    20, 0, 2);
-  }
-
-  #ifdef __LARSOFT__
-  void TheoristsW::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
+void Distribution::UseSums(BinSums::Bin* bins, double* nentries) {
+  sums.reset(new BinSums(bins, hist->GetNcells(), nentries));
+}
 
-    TLorentzVector q = nu.Nu().Momentum() - nu.Lepton().Momentum();
 
-    float Q2 = q.Mag2()*-1;
+void Distribution::UseChannels(double* cells) {
+  channels.reset(new WeightChannels(cells, hist->GetNcells(), weights->size(), weights->NSlices()));
+}
 
-    // To get 4-vector p we need the struck nucleon
-    // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code = 11, this is the struc nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1.
-    int i_nuc = -999;
 
-    if (truth.GetParticle(2).StatusCode() == 11){
-      i_nuc = 2;
+void Distribution::Merge(const Distribution& other) {
+  hist->Add(other.hist);
+  // Sums and channels in a BinArena are merged with the whole arena
+  if (other.sums && !other.sums->InArena()) {
+    if (sums) {
+      sums->Merge(*other.sums);
     }
-    else{
-      i_nuc = 1;
+    else {
+      sums.reset(new BinSums(*other.sums));
     }
-    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
+  }
+  if (channels && !other.channels->InArena()) {
+    channels->Merge(*other.channels);
+  }
+}
 
-    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
 
-    TLorentzVector p = truth.GetParticle(i_nuc).Momentum();
+void Distribution::Flush() {
+  if (sums && sums->GetEntries() > 0) {
+    sums->Copy(hist);
+  }
+}
 
-    float w_theorist = TMath::Sqrt(p.Mag2() + 2*p.Dot(q) - Q2);
 
-    dynamic_cast<TH1F*>(hist)->Fill(w_theorist, w);
+void Distribution::Write() {
+  Flush();
+  if (hist->GetEntries() == 0) {
+    return;
+  }
+  std::cout << "WRITE " << hist->GetName() << std::endl;
+  hist->Write();
+  if (!channels) {
+    return;
   }
-  #endif
 
-  void TheoristsW::Fill(const NuisTree& nuistr) {
-    // Find neutrino and nucleon in list of initial state particles
-    int i_nuc = -999;
-    int i_nu = -999;
-    for (int i=0; i<nuistr.ninitp; i++) {
-      if (nuistr.initp_pdg[i]==2212 || nuistr.initp_pdg[i]==2112){
-        // check this is the only initial nucleon we've found
-        assert(i_nuc==-999);
-        i_nuc = i;
-      }
-      if (nuistr.initp_pdg[i]==nuistr.PDGnu){
-        // check this is the only neutrino we've found
-        assert(i_nu==-999);
-        i_nu = i;
-      }
-    }
+  std::string hname = hist->GetName();
+  WriteChannels(hname, hist->GetTitle(), channels->GetSums(-1));
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
-      }
-    }
+  // Sliced copies, e.g. "hq2_num_ccqe_q2_slice0"
+  const Slicer* slicer = weights->slicer;
+  for (size_t k=0; slicer && k<slicer->size(); k++) {
+    std::string sname = hname + "_slice" + std::to_string(k);
+    std::string stitle = std::string(hist->GetTitle()) + ", " + slicer->Label(k);
+    std::vector<double> sums = channels->GetSums(k);
+    channels->WriteChannel(hist, sname, stitle, sums, weights->NominalChannel());
+    WriteChannels(sname, stitle, sums);
+  }
+}
 
-    assert (i_nuc!=-999);
-    assert (i_nu!=-999);
-    assert (i_lep!=-999);
 
-    TLorentzVector k(nuistr.initp_px[i_nu],nuistr.initp_py[i_nu],nuistr.initp_pz[i_nu],nuistr.initp_E[i_nu]);
-    TLorentzVector kprime(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep],nuistr.fsp_E[i_lep]);
+void Distribution::WriteChannels(const std::string& hname, const std::string& htitle,
+                                 const std::vector<double>& sums) {
+  if (weights->nuniverses > 0) {
+    channels->WriteSpread(hist, hname + "_univ", htitle, sums, 0, weights->nuniverses);
+  }
+  for (size_t k=0; k<weights->sets.size(); k++) {
+    // Name after the expression, e.g. "hq2_num_ccqe_q2_InputWeightxRWWeight"
+    std::string label = weights->sets[k];
+    std::replace(label.begin(), label.end(), '*', 'x');
+    channels->WriteChannel(hist, hname + "_" + label, htitle, sums, weights->SetChannel(k));
+  }
+  if (weights->nreplicas > 0) {
+    channels->WriteSpread(hist, hname + "_boot", htitle, sums, weights->ReplicaChannel(), weights->nreplicas);
+  }
+}
 
-    TLorentzVector q = k-kprime;
-    // Sanity check: q should match saved values in tree!
-    assert(q.Mag2()*-1 - nuistr.Q2 < 1e-4);
 
-    TLorentzVector p(nuistr.initp_px[i_nuc],nuistr.initp_py[i_nuc],nuistr.initp_pz[i_nuc],nuistr.initp_E[i_nuc]);
+void Distribution::Save(TCanvas* c) {
+  Flush();
+  if (hist->GetEntries() == 0) {
+    return;
+  }
+  bool own_canvas = c == NULL;
+  c = (c == NULL ? new TCanvas("c1", "", 500, 500) : c);
+  c->cd();
+  hist->Draw("colz");
+  c->SaveAs((std::string("hist_") + name + ".png").c_str());
+  if (own_canvas) delete c;
+}
 
-    float w_theorist = TMath::Sqrt(p.Mag2() + 2*p.Dot(q) - nuistr.Q2);
 
-    dynamic_cast<TH1F*>(hist)->Fill(w_theorist,nuistr.Weight);
-  }
+// Kinematic kernels, templates on an event view (see eventview.h) so that
+// the gallery and NUISANCE fills share one implementation
+namespace kinematics {
 
+  const float kNeutronMass = 0.93956541;  // GeV
 
-  ExperimentalistsW::ExperimentalistsW(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Experimentalists W = sqrt(M^2 + 2Mq0 - Q^2), ") + _filter->title;
-    std::string hname = "hexpw_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Experimentalists W = sqrt(M^2 + 2Mq0 - Q^2) (GeV);Events").c_str(),
-                    20, 0.5, 1.5);
+  // W = sqrt(p.p + 2p.q - Q^2), with p the struck nucleon
+  template <class View>
+  float TheoristsW(const View& ev) {
+    FourVectorD q = ev.Nu().P4() - ev.Lepton().P4();
+    // Sanity check: q should match the event's Q^2
+    assert(q.Mag2()*-1 - ev.Q2() < 1e-4);
+    FourVectorD p = ev.Nucleon().P4();
+    return std::sqrt(p.Mag2() + 2*p.Dot(q) - ev.Q2());
   }
 
-  #ifdef __LARSOFT__
-  void ExperimentalistsW::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(truth.GetNeutrino().W(), w);
+  // x = Q^2/(2p.q)
+  template <class View>
+  float TheoristsBjorkenX(const View& ev) {
+    FourVectorD q = ev.Nu().P4() - ev.Lepton().P4();
+    assert(q.Mag2()*-1 - ev.Q2() < 1e-4);
+    FourVectorD p = ev.Nucleon().P4();
+    return ev.Q2()/(2*p.Dot(q));
   }
-  #endif
-
-  void ExperimentalistsW::Fill(const NuisTree& nuistr) {
-    //dynamic_cast<TH1F*>(hist)->Fill(nuistr.W_nuc_rest,nuistr.Weight);
 
-    float Q2 = nuistr.Q2;
-    float q0 = nuistr.q0;
-    float M = 0.93956541; // neutron mass GeV
-    float W = TMath::Sqrt(M*M + 2*M*q0 - Q2);
-    dynamic_cast<TH1F*>(hist)->Fill(W,nuistr.Weight);
+  // y = (p.q)/(p.k)
+  template <class View>
+  float TheoristsInelasticityY(const View& ev) {
+    FourVectorD k = ev.Nu().P4();
+    FourVectorD q = k - ev.Lepton().P4();
+    assert(q.Mag2()*-1 - ev.Q2() < 1e-4);
+    FourVectorD p = ev.Nucleon().P4();
+    return (p.Dot(q))/(p.Dot(k));
   }
 
+  // nu = p.q/sqrt(p^2)
+  template <class View>
+  float TheoristsNu(const View& ev) {
+    FourVectorD q = ev.Nu().P4() - ev.Lepton().P4();
+    assert(q.Mag2()*-1 - ev.Q2() < 1e-4);
+    FourVectorD p = ev.Nucleon().P4();
+    return (p.Dot(q))/(p.Mag());
+  }
 
-  TheoristsBjorkenX::TheoristsBjorkenX(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Theorists Bjorken x = Q^2/(2p.q), ") + _filter->title;
-    std::string hname = "hthbx_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Theorists Bjorken x = Q^2/(2p.q);Events").c_str(),
-                    10, 0, 1);
+  // W = sqrt(M^2 + 2Mq0 - Q^2), with M the neutron mass
+  template <class View>
+  float ExperimentalistsW(const View& ev) {
+    float M = kNeutronMass;
+    return std::sqrt(M*M + 2*M*ev.q0() - ev.Q2());
   }
 
-  #ifdef __LARSOFT__
-  void TheoristsBjorkenX::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
+  // x = Q^2/(2Mq0)
+  template <class View>
+  float ExperimentalistsBjorkenX(const View& ev) {
+    return ev.Q2()/(2*kNeutronMass*ev.q0());
+  }
 
-    TLorentzVector q = nu.Nu().Momentum() - nu.Lepton().Momentum();
+  // Binding energy from full-event energy conservation
+  template <class View>
+  float BindingE(const View& ev) {
+    constexpr double TARGET_MASS = 37.215526; // 40Ar, GeV
+    constexpr double NEUTRON_MASS = 0.93956541; // GeV
 
-    float Q2 = q.Mag2()*-1;
+    FourVectorD p4v = ev.Nu().P4(); // neutrino
+    FourVectorD p4Ni = ev.Nucleon().P4(); // initial hit nucleon
+    FourVectorD p4l = ev.Lepton().P4(); // lepton
+    FourVectorD p4i{0., 0., 0., TARGET_MASS}; // target
 
-    // To get 4-vector p we need the struck nucleon
-    // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code = 11, this is the struc nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1.
-    int i_nuc = -999;
-    if (truth.GetParticle(2).StatusCode() == 11){
-      i_nuc = 2;
-    }
-    else{
-      i_nuc = 1;
-    }
-    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
-    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
+    // Final nucleon 4-momentum: p + k = p' + k' -> p' = p + k - k' -> p' = p + q
+    FourVectorD p4Nf = p4Ni + p4v - p4l;
 
-    TLorentzVector p = truth.GetParticle(i_nuc).Momentum();
+    // Recoil nucleus 4-momentum
+    FourVectorD p4f = p4v + p4i - p4l - p4Nf;
+    // Recoiling nucleus mass (takes into account any excitation energy implied
+    // by the initial bound nucleon 4-momentum)
+    double mf = p4f.M();
+    // Kinetic energy of the recoiling nucleus
+    double Tf = p4f.E - mf;
 
-    float x = Q2/(2*p.Dot(q));
+    return p4v.E + NEUTRON_MASS - p4Nf.E - p4l.E - Tf;
+  }
 
-    dynamic_cast<TH1F*>(hist)->Fill(x, w);
+  // Lepton cos(theta) from its momentum
+  template <class View>
+  float ThetaLep(const View& ev) {
+    return ev.Lepton().P3().CosTheta();
   }
-  #endif
 
-  void TheoristsBjorkenX::Fill(const NuisTree& nuistr) {
-    // Find neutrino and nucleon in list of initial state particles
-    int i_nuc = -999;
-    int i_nu = -999;
-    for (int i=0; i<nuistr.ninitp; i++) {
-      if (nuistr.initp_pdg[i]==2212 || nuistr.initp_pdg[i]==2112){
-        // check this is the only initial nucleon we've found
-        assert(i_nuc==-999);
-        i_nuc = i;
-      }
-      if (nuistr.initp_pdg[i]==nuistr.PDGnu){
-        // check this is the only neutrino we've found
-        assert(i_nu==-999);
-        i_nu = i;
+  // Leading (highest KE) and subleading proton KE
+  inline void ProtonKE(const ParticleSpan& fs, float& KElead, float& KEsub) {
+    KElead = 0;
+    KEsub = 0;
+    for (int i=0; i<fs.n; i++) {
+      if (fs.pdg[i] == 2212) {
+        float ke = fs.ke[i];
+        if (ke > KEsub) {
+          if (ke > KElead) {
+            KEsub = KElead;
+            KElead = ke;
+          }
+          else {
+            KEsub = ke;
+          }
+        }
       }
     }
+  }
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
+  // Index of the highest momentum particle passing a selection (called with
+  // the PDG code and KE), or -1 if none pass; n is set to the number passing.
+  // If all passing particles are at rest, this is the first of them.
+  template <class Select>
+  int Leading(const ParticleSpan& fs, Select select, size_t& n) {
+    n = 0;
+    int ilead = -1;
+    float plead = 0;
+    for (int i=0; i<fs.n; i++) {
+      if (select(fs.pdg[i], fs.ke[i])) {
+        n++;
+        if (ilead < 0 || fs.p[i] > plead) {
+          plead = fs.p[i];
+          ilead = i;
+        }
       }
     }
+    return ilead;
+  }
 
-    assert (i_nuc!=-999);
-    assert (i_nu!=-999);
-    assert (i_lep!=-999);
-
-    TLorentzVector k(nuistr.initp_px[i_nu],nuistr.initp_py[i_nu],nuistr.initp_pz[i_nu],nuistr.initp_E[i_nu]);
-    TLorentzVector kprime(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep],nuistr.fsp_E[i_lep]);
-
-    TLorentzVector q = k-kprime;
-    // Sanity check: q should match saved values in tree!
-    assert(q.Mag2()*-1 - nuistr.Q2 < 1e-4);
-
-    TLorentzVector p(nuistr.initp_px[i_nuc],nuistr.initp_py[i_nuc],nuistr.initp_pz[i_nuc],nuistr.initp_E[i_nuc]);
+  // Protons above a KE threshold
+  struct ProtonAbove {
+    float ethreshold;
+    bool operator()(int pdg, float ke) const { return pdg == 2212 && ke > ethreshold; }
+  };
 
-    float x = nuistr.Q2/(2*p.Dot(q));
+  // Charged (or all) pions
+  struct Pion {
+    bool charged;
+    bool operator()(int pdg, float) const { return abs(pdg) == 211 || (!charged && pdg == 111); }
+  };
 
-    dynamic_cast<TH1F*>(hist)->Fill(x, nuistr.Weight);
+  // Number of final state particles of a species above a KE threshold
+  inline size_t Count(const ParticleSpan& fs, int pdg, float ethreshold) {
+    size_t nf = 0;
+    for (int i=0; i<fs.n; i++) {
+      if (fs.pdg[i] == pdg && fs.ke[i] > ethreshold) {
+        nf++;
+      }
+    }
+    return nf;
   }
 
+  // Cosine of the angle between a particle and final state particle i (1 if
+  // either has zero momentum)
+  inline float CosAngle(const Particle& a, const ParticleSpan& fs, int i) {
+    float norm = a.P() * fs.p[i];
+    if (norm <= 0) return 1;
+    float cosangle = (a.px * fs.px[i] + a.py * fs.py[i] + a.pz * fs.pz[i]) / norm;
+    return std::max(-1.0f, std::min(1.0f, cosangle));
+  }
 
-  ExperimentalistsBjorkenX::ExperimentalistsBjorkenX(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Experimentalists Bjorken x = Q^2/(2Mq0), ") + _filter->title;
-    std::string hname = "hexpbx_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Experimentalists Bjorken x = Q^2/(2Mq0);Events").c_str(),
-                    15, 0, 1.5);
+  // phi of a particle minus phi of final state particle i, in [-pi, pi]
+  inline float DeltaPhi(const Particle& a, const ParticleSpan& fs, int i) {
+    float dphi = std::atan2(a.py, a.px) - fs.phi[i];
+    if (dphi > float(M_PI)) dphi -= 2 * float(M_PI);
+    else if (dphi < -float(M_PI)) dphi += 2 * float(M_PI);
+    return dphi;
   }
 
+
+  // Intermediate (pre-FSI) hadrons of a species
   #ifdef __LARSOFT__
-  void ExperimentalistsBjorkenX::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(truth.GetNeutrino().X(), w);
+  inline size_t IntermediateCount(const TruthView& ev, int pdg) {
+    const simb::MCTruth& truth = ev.Truth();
+    size_t nf = -999;
+
+    assert(pdg == 2212 || pdg == 2112 || pdg == 211 || pdg == -211 || pdg ==111);
+
+    for (int i=0; i<truth.NParticles(); i++){
+      const simb::MCParticle &p = truth.GetParticle(i);
+      if (p.PdgCode() == pdg && p.StatusCode() == genie::kIStHadronInTheNucleus){
+	nf++;
+      }
+    }
+
+    return nf;
   }
   #endif
 
-  void ExperimentalistsBjorkenX::Fill(const NuisTree& nuistr) {
-    //dynamic_cast<TH1F*>(hist)->Fill(nuistr.x, nuistr.Weight);
+  inline size_t IntermediateCount(const NuisView&, int) {
+    // Nuisance tree gives "vertex particles" -- not sure but assuming this is the same thing as intermediate particles
+    // Actually, have recently found that Nuisance "vertex particles" might have a bug. Comenting this out and just filling with -999 to avoid confusion. If we decide we need this, may have to go back and check nuisance code first.
 
-    float Q2 = nuistr.Q2;
-    float q0 = nuistr.q0;
-    float M = 0.93956541; // neutron mass GeV                                                                               
-    float x = Q2/(2*M*q0);
-    dynamic_cast<TH1F*>(hist)->Fill(x,nuistr.Weight);
-  }
+    size_t nf = -999;
 
+    // for (int i=0; i<nuistr.nvertp; i++){
+    //   if (nuistr.vertp_pdg[i] == pdg){
+    //     nf++;
+    //   }
+    // }
 
-  TheoristsInelasticityY::TheoristsInelasticityY(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Theorists Inelasticity y = (p.q)/(p.k), ") + _filter->title;
-    std::string hname = "hthinely_" + name;
-    hist = new TH1F(hname.c_str(),
-                    (title + ";Theorists Inelasticity y = (p.q)/(p.k);Events").c_str(),
-                    20, 0, 1);
+    return nf;
   }
 
+  // Energy balance, initial minus final state
   #ifdef __LARSOFT__
-  void TheoristsInelasticityY::Fill(const simb::MCTruth& truth, float w) {
+  inline float EnergyBalance(const TruthView& ev) {
+    const simb::MCTruth& truth = ev.Truth();
+    float pmass = TDatabasePDG::Instance()->GetParticle(2212)->Mass();
+    float nmass = TDatabasePDG::Instance()->GetParticle(2112)->Mass();
+
+    //// Initial state
     const simb::MCNeutrino& nu = truth.GetNeutrino();
 
-    TLorentzVector q = nu.Nu().Momentum() - nu.Lepton().Momentum();
+    // Neutrino energy
+    float enu = nu.Nu().E();
+
+    // Target nucleus rest mass
+    float tgtmass;
+    int tgtpdg = nu.Target();
+    TParticlePDG* tgtparticle = TDatabasePDG::Instance()->GetParticle(tgtpdg);
+    if (tgtparticle) {
+      tgtmass = tgtparticle->Mass();
+    }
+    else {
+      int tgtZ = IonPdgCodeToZ(tgtpdg);
+      int tgtA = IonPdgCodeToA(tgtpdg);
+
+      tgtmass = tgtZ * pmass + (tgtA - tgtZ) * nmass;
+    }
 
-    // To get 4-vector p we need the struck nucleon
+    // Struck nucleon KE
     // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code = 11, this is the struc nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1.
+    // Check particle 2 - if status code == 11, this is the struck nucleon
+    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1
     int i_nuc = -999;
     if (truth.GetParticle(2).StatusCode() == 11){
       i_nuc = 2;
@@ -316,298 +406,268 @@ namespace distributions {
     int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
     assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
 
-    TLorentzVector p = truth.GetParticle(i_nuc).Momentum();
-
-    TLorentzVector k = nu.Nu().Momentum();
+    float nucmass = TDatabasePDG::Instance()->GetParticle(nuc_pdg)->Mass();
+    float enuc = truth.GetParticle(i_nuc).Momentum().E() - nucmass;
 
-    float y = (p.Dot(q))/(p.Dot(k));
+    // Total
+    float ei = enu + tgtmass + enuc;
 
-    dynamic_cast<TH1F*>(hist)->Fill(y, w);
-  }
-  #endif
+    //// Final state
+    // Lepton total energy
+    float elep = nu.Lepton().E();
 
-  void TheoristsInelasticityY::Fill(const NuisTree& nuistr) {
-    // Find neutrino and nucleon in list of initial state particles
-    int i_nuc = -999;
-    int i_nu = -999;
-    for (int i=0; i<nuistr.ninitp; i++) {
-      if (nuistr.initp_pdg[i]==2212 || nuistr.initp_pdg[i]==2112){
-        // check this is the only initial nucleon we've found
-        assert(i_nuc==-999);
-        i_nuc = i;
+    // Nuclear remnant rest mass
+    float remnantmass = 0;
+    for (int i=0; i<truth.NParticles(); i++) {
+      const simb::MCParticle& p = truth.GetParticle(i);
+      if (p.StatusCode() != genie::kIStFinalStateNuclearRemnant) {
+        continue;
       }
-      if (nuistr.initp_pdg[i]==nuistr.PDGnu){
-        // check this is the only neutrino we've found
-        assert(i_nu==-999);
-        i_nu = i;
+      TParticlePDG* rpart = TDatabasePDG::Instance()->GetParticle(p.PdgCode());
+      if (rpart) {
+        remnantmass += tgtparticle->Mass();
+      }
+      else {
+        int a = IonPdgCodeToA(p.PdgCode());
+        int z = IonPdgCodeToZ(p.PdgCode());
+        remnantmass += z * pmass + (a - z) * nmass;
       }
     }
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
+    // Final state hadrons
+    float ehad = 0;
+    for (int i=0; i<truth.NParticles(); i++) {
+      const simb::MCParticle& p = truth.GetParticle(i);
+
+      if (p.StatusCode() != genie::kIStStableFinalState) {
+        continue;
       }
-    }
 
-    assert (i_nuc!=-999);
-    assert (i_nu!=-999);
-    assert (i_lep!=-999);
+      TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(p.PdgCode());
+      assert(particle || p.PdgCode() == 2000000101);
+      float mass = particle ? particle->Mass() : 0;
 
-    TLorentzVector k(nuistr.initp_px[i_nu],nuistr.initp_py[i_nu],nuistr.initp_pz[i_nu],nuistr.initp_E[i_nu]);
-    TLorentzVector kprime(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep],nuistr.fsp_E[i_lep]);
+      ehad += p.E() - mass;
+    }
 
-    TLorentzVector q = k-kprime;
-    // Sanity check: q should match saved values in tree!
-    assert(q.Mag2()*-1 - nuistr.Q2 < 1e-4);
+    // Total
+    float ef = elep + remnantmass + ehad;
 
-    TLorentzVector p(nuistr.initp_px[i_nuc],nuistr.initp_py[i_nuc],nuistr.initp_pz[i_nuc],nuistr.initp_E[i_nuc]);
+    // Balance
+    float de = ei-ef;
 
-    float y = (p.Dot(q))/(p.Dot(k));
+    return de;
+  }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(y, nuistr.Weight);
+  inline float EnergyBalance(const NuisView&) {
+    // It's not clear that we can recreate this plot with NUISANCE trees (and I'm worried that if we try we will end up with inconsistencies of O(binding energy) with the GENIE implementation that could cause a lot of confusion) so don't try. Just fill with 0s -- if we need to make a similar plot to this in the future, can think through exactly what we want to show and whether that's possible to implement with the NUISANCE trees
+    return 0;
   }
 
+}  // namespace kinematics
 
-  ExperimentalistsInelasticityY::ExperimentalistsInelasticityY(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Experimentalists Inelasticity y = 1-(Elep/Enu), ") + _filter->title;
-    std::string hname = "hexpinely_" + name;
+
+namespace distributions {
+
+  Q2::Q2(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Q^{2}, ") + _filter->title;
+    std::string hname = "hq2_" + name;
     hist = new TH1F(hname.c_str(),
-                    (title + ";Experimentalists Inelasticity y = 1-(Elep/Enu);Events").c_str(),
-                    20, 0, 1);
+                    (title + ";Q^{2} (GeV^{2});Events").c_str(),
+                    20, 0, 2);
   }
 
-  #ifdef __LARSOFT__
-  void ExperimentalistsInelasticityY::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(truth.GetNeutrino().Y(), w);
+  template <class View>
+  void Q2::FillEvent(const View& ev, double w) {
+    FillHist(ev.Q2(), w);
   }
+
+  #ifdef __LARSOFT__
+  void Q2::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void ExperimentalistsInelasticityY::Fill(const NuisTree& nuistr) {
-    dynamic_cast<TH1F*>(hist)->Fill(nuistr.y, nuistr.Weight);
-  }
+  void Q2::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
-  TheoristsNu::TheoristsNu(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Theorists nu = p.q/sqrt(p^2), ") + _filter->title;
-    std::string hname = "hthnu_" + name;
+  TheoristsW::TheoristsW(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Theorists W = sqrt(p.p + 2p.q - Q^2), ") + _filter->title;
+    std::string hname = "hthw_" + name;
     hist = new TH1F(hname.c_str(),
-                    (title + ";Theorists nu = p.q/sqrt(p^2);Events").c_str(),
-                    20, 0, 1);
+                    (title + ";Theorists W = sqrt(p.p + 2p.q - Q^2) (GeV);Events").c_str(),
+                    20, 0, 2);
   }
 
-  #ifdef __LARSOFT__
-  void TheoristsNu::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
+  template <class View>
+  void TheoristsW::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::TheoristsW(ev), w);
+  }
 
-    TLorentzVector q = nu.Nu().Momentum() - nu.Lepton().Momentum();
+  #ifdef __LARSOFT__
+  void TheoristsW::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    // To get 4-vector p we need the struck nucleon
-    // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code = 11, this is the struc nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1.
-    int i_nuc = -999;
-    if (truth.GetParticle(2).StatusCode() == 11){
-      i_nuc = 2;
-    }
-    else{
-      i_nuc = 1;
-    }
-    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
-    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
+  void TheoristsW::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    TLorentzVector p = truth.GetParticle(i_nuc).Momentum();
 
-    float nu_theorist = p.Dot(q)/TMath::Sqrt(p.Mag2());
+  ExperimentalistsW::ExperimentalistsW(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Experimentalists W = sqrt(M^2 + 2Mq0 - Q^2), ") + _filter->title;
+    std::string hname = "hexpw_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Experimentalists W = sqrt(M^2 + 2Mq0 - Q^2) (GeV);Events").c_str(),
+                    20, 0.5, 1.5);
+  }
 
-    dynamic_cast<TH1F*>(hist)->Fill(nu_theorist, w);
+  template <class View>
+  void ExperimentalistsW::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::ExperimentalistsW(ev), w);
   }
+
+  #ifdef __LARSOFT__
+  void ExperimentalistsW::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void TheoristsNu::Fill(const NuisTree& nuistr) {
-    // Find neutrino and nucleon in list of initial state particles
-    int i_nuc = -999;
-    int i_nu = -999;
-    for (int i=0; i<nuistr.ninitp; i++) {
-      if (nuistr.initp_pdg[i]==2212 || nuistr.initp_pdg[i]==2112){
-        // check this is the only initial nucleon we've found
-        assert(i_nuc==-999);
-        i_nuc = i;
-      }
-      if (nuistr.initp_pdg[i]==nuistr.PDGnu){
-        // check this is the only neutrino we've found
-        assert(i_nu==-999);
-        i_nu = i;
-      }
-    }
+  void ExperimentalistsW::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
-      }
-    }
 
-    assert (i_nuc!=-999);
-    assert (i_nu!=-999);
-    assert (i_lep!=-999);
+  TheoristsBjorkenX::TheoristsBjorkenX(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Theorists Bjorken x = Q^2/(2p.q), ") + _filter->title;
+    std::string hname = "hthbx_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Theorists Bjorken x = Q^2/(2p.q);Events").c_str(),
+                    10, 0, 1);
+  }
+
+  template <class View>
+  void TheoristsBjorkenX::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::TheoristsBjorkenX(ev), w);
+  }
 
-    TLorentzVector k(nuistr.initp_px[i_nu],nuistr.initp_py[i_nu],nuistr.initp_pz[i_nu],nuistr.initp_E[i_nu]);
-    TLorentzVector kprime(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep],nuistr.fsp_E[i_lep]);
+  #ifdef __LARSOFT__
+  void TheoristsBjorkenX::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    TLorentzVector q = k-kprime;
-    // Sanity check: q should match saved values in tree!
-    assert((q.Mag2()*-1 - nuistr.Q2) < 1e-4);
+  void TheoristsBjorkenX::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    TLorentzVector p(nuistr.initp_px[i_nuc],nuistr.initp_py[i_nuc],nuistr.initp_pz[i_nuc],nuistr.initp_E[i_nuc]);
 
-    float nu_theorist = (p.Dot(q))/(p.Mag());
+  ExperimentalistsBjorkenX::ExperimentalistsBjorkenX(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Experimentalists Bjorken x = Q^2/(2Mq0), ") + _filter->title;
+    std::string hname = "hexpbx_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Experimentalists Bjorken x = Q^2/(2Mq0);Events").c_str(),
+                    15, 0, 1.5);
+  }
 
-    dynamic_cast<TH1F*>(hist)->Fill(nu_theorist, nuistr.Weight);
+  template <class View>
+  void ExperimentalistsBjorkenX::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::ExperimentalistsBjorkenX(ev), w);
   }
 
+  #ifdef __LARSOFT__
+  void ExperimentalistsBjorkenX::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
+
+  void ExperimentalistsBjorkenX::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-  ExperimentalistsNu::ExperimentalistsNu(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Experimentalists nu = Enu-Elep = q0, ") + _filter->title;
-    std::string hname = "hexpnu_" + name;
+
+  TheoristsInelasticityY::TheoristsInelasticityY(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Theorists Inelasticity y = (p.q)/(p.k), ") + _filter->title;
+    std::string hname = "hthinely_" + name;
     hist = new TH1F(hname.c_str(),
-                    (title + ";Experimentalists nu = Enu-Elep = q0;Events").c_str(),
+                    (title + ";Theorists Inelasticity y = (p.q)/(p.k);Events").c_str(),
                     20, 0, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ExperimentalistsNu::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
-    float q0 = nu.Nu().E() - nu.Lepton().E();
-    dynamic_cast<TH1F*>(hist)->Fill(q0, w);
+  template <class View>
+  void TheoristsInelasticityY::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::TheoristsInelasticityY(ev), w);
   }
+
+  #ifdef __LARSOFT__
+  void TheoristsInelasticityY::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void ExperimentalistsNu::Fill(const NuisTree& nuistr) {
-    dynamic_cast<TH1F*>(hist)->Fill(nuistr.q0, nuistr.Weight);
-  }
+  void TheoristsInelasticityY::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
-  BindingE::BindingE(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
-    title = std::string("Binding Energy from energy balance (GeV), ") + _filter->title;
-    std::string hname = "hbe_" + name;
+  ExperimentalistsInelasticityY::ExperimentalistsInelasticityY(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Experimentalists Inelasticity y = 1-(Elep/Enu), ") + _filter->title;
+    std::string hname = "hexpinely_" + name;
     hist = new TH1F(hname.c_str(),
-                    (title + ";Binding Energy from energy balance (GeV);Events").c_str(),
-                    50, 0, 0.1);
+                    (title + ";Experimentalists Inelasticity y = 1-(Elep/Enu);Events").c_str(),
+                    20, 0, 1);
+  }
+
+  template <class View>
+  void ExperimentalistsInelasticityY::FillEvent(const View& ev, double w) {
+    FillHist(ev.y(), w);
   }
 
   #ifdef __LARSOFT__
-  void BindingE::Fill(const simb::MCTruth& truth, float w) {
-    constexpr double TARGET_MASS = 37.215526; // 40Ar, GeV
-    constexpr double NEUTRON_MASS = 0.93956541; // GeV
-    // constexpr double PROTON_MASS = 0.93827208; // GeV
+  void ExperimentalistsInelasticityY::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
+  void ExperimentalistsInelasticityY::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    // To get 4-vector p we need the struck nucleon
-    // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code = 11, this is the struc nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1.
-    int i_nuc = -999;
-    if (truth.GetParticle(2).StatusCode() == 11){
-      i_nuc = 2;
-    }
-    else{
-      i_nuc = 1;
-    }
-    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
-    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
 
-    TLorentzVector p4v = nu.Nu().Momentum(); // neutrino
-    TLorentzVector p4Ni = truth.GetParticle(i_nuc).Momentum(); // initial hit nucleon
-    TLorentzVector p4l = nu.Lepton().Momentum(); // lepton
-    TLorentzVector p4i(0., 0., 0., TARGET_MASS); // target
+  TheoristsNu::TheoristsNu(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Theorists nu = p.q/sqrt(p^2), ") + _filter->title;
+    std::string hname = "hthnu_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Theorists nu = p.q/sqrt(p^2);Events").c_str(),
+                    20, 0, 1);
+  }
 
-    // Final nucleon 4-momentum: p + k = p' + k' -> p' = p + k - k' -> p' = p + q
-    TLorentzVector p4Nf = p4Ni + p4v - p4l;
+  template <class View>
+  void TheoristsNu::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::TheoristsNu(ev), w);
+  }
 
-    // Recoil nucleus 4-momentum
-    TLorentzVector p4f = p4v + p4i - p4l - p4Nf;
-    // Recoiling nucleus mass (takes into account any excitation energy implied
-    // by the initial bound nucleon 4-momentum)
-    double mf = p4f.M();
-    // Kinetic energy of the recoiling nucleus
-    double Tf = p4f.E() - mf;
+  #ifdef __LARSOFT__
+  void TheoristsNu::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    // Binding energy from hit nucleon total energy
-    // double Eb_from_En = NEUTRON_MASS - p4Ni.E() - Tf;
-    // Binding energy from full-event energy conservation
-    double reco_Eb = p4v.E() + NEUTRON_MASS - p4Nf.E() - p4l.E() - Tf;
+  void TheoristsNu::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    //std::cout << p4v.E() << ", " << p4Nf.E() << ", " << p4l.E() << ": " << reco_Eb << std::endl;
 
-    dynamic_cast<TH1F*>(hist)->Fill(reco_Eb, w);
+  ExperimentalistsNu::ExperimentalistsNu(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Experimentalists nu = Enu-Elep = q0, ") + _filter->title;
+    std::string hname = "hexpnu_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Experimentalists nu = Enu-Elep = q0;Events").c_str(),
+                    20, 0, 1);
   }
-  #endif
 
-  void BindingE::Fill(const NuisTree& nuistr) {
-    constexpr double TARGET_MASS = 37.215526; // 40Ar, GeV
-    constexpr double NEUTRON_MASS = 0.93956541; // GeV
-    // constexpr double PROTON_MASS = 0.93827208; // GeV
-    // Find neutrino and nucleon in list of initial state particles
-    int i_nuc = -999;
-    int i_nu = -999;
-    for (int i=0; i<nuistr.ninitp; i++) {
-      if (nuistr.initp_pdg[i]==2212 || nuistr.initp_pdg[i]==2112){
-        // check this is the only initial nucleon we've found
-        assert(i_nuc==-999);
-        i_nuc = i;
-      }
-      if (nuistr.initp_pdg[i]==nuistr.PDGnu){
-        // check this is the only neutrino we've found
-        assert(i_nu==-999);
-        i_nu = i;
-      }
-    }
+  template <class View>
+  void ExperimentalistsNu::FillEvent(const View& ev, double w) {
+    FillHist(ev.q0(), w);
+  }
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
-      }
-    }
+  #ifdef __LARSOFT__
+  void ExperimentalistsNu::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    assert (i_nuc!=-999);
-    assert (i_nu!=-999);
-    assert (i_lep!=-999);
+  void ExperimentalistsNu::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    TLorentzVector p4v(nuistr.initp_px[i_nu],nuistr.initp_py[i_nu],nuistr.initp_pz[i_nu],nuistr.initp_E[i_nu]); // neutrino
-    TLorentzVector p4Ni(nuistr.initp_px[i_nuc],nuistr.initp_py[i_nuc],nuistr.initp_pz[i_nuc],nuistr.initp_E[i_nuc]); // initial hit nucleon
-    TLorentzVector p4l(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep],nuistr.fsp_E[i_lep]); // lepton
-    TLorentzVector p4i(0., 0., 0., TARGET_MASS); // target
 
-    // Final nucleon 4-momentum: p + k = p' + k' -> p' = p + k - k' -> p' = p + q
-    TLorentzVector p4Nf = p4Ni + p4v - p4l;
+  BindingE::BindingE(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("Binding Energy from energy balance (GeV), ") + _filter->title;
+    std::string hname = "hbe_" + name;
+    hist = new TH1F(hname.c_str(),
+                    (title + ";Binding Energy from energy balance (GeV);Events").c_str(),
+                    50, 0, 0.1);
+  }
 
-    // Recoil nucleus 4-momentum
-    TLorentzVector p4f = p4v + p4i - p4l - p4Nf;
-    // Recoiling nucleus mass (takes into account any excitation energy implied
-    // by the initial bound nucleon 4-momentum)
-    double mf = p4f.M();
-    // Kinetic energy of the recoiling nucleus
-    double Tf = p4f.E() - mf;
+  template <class View>
+  void BindingE::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::BindingE(ev), w);
+  }
 
-    // Binding energy from hit nucleon total energy
-    // double Eb_from_En = NEUTRON_MASS - p4Ni.E() - Tf;
-    // Binding energy from full-event energy conservation
-    double reco_Eb = p4v.E() + NEUTRON_MASS - p4Nf.E() - p4l.E() - Tf;
+  #ifdef __LARSOFT__
+  void BindingE::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(reco_Eb, nuistr.Weight);
-  }
+  void BindingE::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
 
@@ -619,31 +679,16 @@ namespace distributions {
                     20, 0, 2);
   }
 
-  #ifdef __LARSOFT__
-  void PLep::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(truth.GetNeutrino().Lepton().P(), w);
+  template <class View>
+  void PLep::FillEvent(const View& ev, double w) {
+    FillHist(ev.Lepton().P(), w);
   }
-  #endif
-
-  void PLep::Fill(const NuisTree& nuistr) {
-    // Find final-state lepton in stack
-    int i_lep=-999;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        if (i_lep!=-999){
-          // previously found another lepton -- error!
-        }
-        i_lep = i;
-      }
-    }
 
-    // Now get lepton momentum from components.
-    TVector3 pv(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]);
-    float p = pv.Mag();
+  #ifdef __LARSOFT__
+  void PLep::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(p,nuistr.Weight);
-  }
+  void PLep::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ThetaLep::ThetaLep(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
@@ -654,52 +699,88 @@ namespace distributions {
                     50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ThetaLep::Fill(const simb::MCTruth& truth, float w) {
-    dynamic_cast<TH1F*>(hist)->Fill(cos(truth.GetNeutrino().Lepton().Momentum().Theta()), w);
+  template <class View>
+  void ThetaLep::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::ThetaLep(ev), w);
   }
+
+  #ifdef __LARSOFT__
+  void ThetaLep::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void ThetaLep::Fill(const NuisTree& nuistr) {
-    //dynamic_cast<TH1F*>(hist)->Fill(nuistr.CosLep,nuistr.Weight);
+  void ThetaLep::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    // Find lepton  in list of final state particles
-    int i_lep = -999;
-    for (int i=0; i<nuistr.nfsp; i++) {
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
-      }
-    }
 
-    assert (i_lep!=-999);
+  Q0Q3::Q0Q3(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+    title = std::string("q^{0}/q^{3}, ") + _filter->title;
+    std::string hname = "hq0q3_" + name;
+    hist = new TH2F(hname.c_str(),
+                    (title + ";q^{0} (GeV);q^{3} (GeV);Events").c_str(),
+                    48, 0, 1.2, 48, 0, 1.2);
+  }
 
-    TVector3 p3l(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]); // lepton
-    float costh = p3l.Unit().Dot(TVector3(0,0,1));
-    dynamic_cast<TH1F*>(hist)->Fill(costh,nuistr.Weight);
+  template <class View>
+  void Q0Q3::FillEvent(const View& ev, double w) {
+    FillHist(ev.q3(), ev.q0(), w);
   }
 
+  #ifdef __LARSOFT__
+  void Q0Q3::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
+
+  void Q0Q3::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-  Q0Q3::Q0Q3(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
+
+  Q0Q3Enu::Q0Q3Enu(std::string _name, Filter* _filter, float _resolution, float _enumax)
+      : Distribution(_name, _filter) {
     title = std::string("q^{0}/q^{3}, ") + _filter->title;
     std::string hname = "hq0q3_" + name;
     hist = new TH2F(hname.c_str(),
                     (title + ";q^{0} (GeV);q^{3} (GeV);Events").c_str(),
                     48, 0, 1.2, 48, 0, 1.2);
+    int nq = std::lround(1.2 / _resolution);
+    int nenu = std::lround(_enumax / _resolution);
+    sparse.reset(new SparseHist({ nq, nq, nenu }, { 0, 0, 0 }, { 1.2, 1.2, _enumax }));
+  }
+
+  template <class View>
+  void Q0Q3Enu::FillEvent(const View& ev, double w) {
+    float q3 = ev.q3();
+    float q0 = ev.q0();
+    if (capture) {
+      FillHist(q3, q0, w);
+      return;
+    }
+    double x[3] = { q3, q0, ev.Enu() };
+    sparse->Fill(x, w);
+    if (channels) {
+      int bin = hist->FindFixBin(q3, q0);
+      channels->Fill(weights->slice, bin, weights->data());
+    }
   }
 
   #ifdef __LARSOFT__
-  void Q0Q3::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
-    float q0 = nu.Nu().E() - nu.Lepton().E();
-    float q3 = (nu.Nu().Momentum().Vect() - nu.Lepton().Momentum().Vect()).Mag();
-    dynamic_cast<TH2F*>(hist)->Fill(q3, q0, w);
-  }
+  void Q0Q3Enu::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void Q0Q3::Fill(const NuisTree& nuistr) {
-    dynamic_cast<TH2F*>(hist)->Fill(nuistr.q3, nuistr.q0, nuistr.Weight);
+  void Q0Q3Enu::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
+
+  void Q0Q3Enu::Merge(const Distribution& other) {
+    Distribution::Merge(other);
+    sparse->Merge(*dynamic_cast<const Q0Q3Enu&>(other).sparse);
+  }
+
+  void Q0Q3Enu::Write() {
+    sparse->Project(hist, { 0, 1 });
+    Distribution::Write();
+    if (hist->GetEntries() > 0) {
+      sparse->Write(std::string(hist->GetName()) + "_nd", title + ";q^{3} (GeV);q^{0} (GeV);E_{#nu} (GeV)");
+    }
+  }
+
+  void Q0Q3Enu::Save(TCanvas* c) {
+    sparse->Project(hist, { 0, 1 });
+    Distribution::Save(c);
   }
 
 
@@ -711,38 +792,19 @@ namespace distributions {
                     50, 0, 0.5, 50, 0, 0.5);
   }
 
-  #ifdef __LARSOFT__
-  void LeadPKEQ0::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
-    float q0 = nu.Nu().E() - nu.Lepton().E();
-
-    float plead = 0;
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-      if (p.PdgCode() == 2212 && p.StatusCode() == genie::kIStStableFinalState) {
-        if (p.P() > plead) {
-          plead = p.E() - 0.938;
-        }
-      }
-    }
-
-    dynamic_cast<TH2F*>(hist)->Fill(plead, q0, w);
+  template <class View>
+  void LeadPKEQ0::FillEvent(const View& ev, double w) {
+    // Leading proton (defined by highest KE)
+    float KElead, KEsub;
+    kinematics::ProtonKE(ev.FinalState(), KElead, KEsub);
+    FillHist(KElead, ev.q0(), w);
   }
-  #endif
 
-  void LeadPKEQ0::Fill(const NuisTree& nuistr) {
-    // Loop through final-state particles and find leading proton (defined by highest KE)
-    float KElead = 0;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i] == 2212){
-        if ((nuistr.fsp_E[i] - 0.938) > KElead){
-          KElead = nuistr.fsp_E[i] - 0.938;
-        }
-      }
-    }
+  #ifdef __LARSOFT__
+  void LeadPKEQ0::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH2F*>(hist)->Fill(KElead, nuistr.q0, nuistr.Weight);
-  }
+  void LeadPKEQ0::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   PThetaLep::PThetaLep(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
@@ -753,32 +815,16 @@ namespace distributions {
                     20, 0, 2, 50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void PThetaLep::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCParticle& lep = truth.GetNeutrino().Lepton();
-    float p = lep.P();
-    float ct = cos(lep.Momentum().Theta());
-    dynamic_cast<TH2F*>(hist)->Fill(p, ct, w);
+  template <class View>
+  void PThetaLep::FillEvent(const View& ev, double w) {
+    FillHist(ev.Lepton().P(), ev.CosLep(), w);
   }
-  #endif
-
-  void PThetaLep::Fill(const NuisTree& nuistr) {
-    // Find final-state lepton in stack
-    int i_lep=-999;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-        // check this is the only lepton we've found
-        assert(i_lep==-999);
-        i_lep = i;
-      }
-    }
 
-    // Now get lepton momentum from components.
-    TVector3 pv(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]);
-    float p = pv.Mag();
+  #ifdef __LARSOFT__
+  void PThetaLep::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH2F*>(hist)->Fill(p, nuistr.CosLep, nuistr.Weight);
-  }
+  void PThetaLep::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   Pke::Pke(std::string _name, Filter* _filter) : Distribution(_name, _filter) {
@@ -789,50 +835,19 @@ namespace distributions {
                     20, 0, 1, 20, 0, 1);
   }
 
-  #ifdef __LARSOFT__
-  void Pke::Fill(const simb::MCTruth& truth, float w) {
-    float plead = 0;
-    float psub = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-      if (p.PdgCode() == 2212 && p.StatusCode() == genie::kIStStableFinalState && p.P() > psub) {
-        if (p.P() > plead) {
-          psub = plead;
-          plead = p.E() - 0.938;
-        }
-        else {
-          psub = p.E() - 0.938;
-        }
-      }
-    }
-
-    dynamic_cast<TH2F*>(hist)->Fill(plead, psub, w);
+  template <class View>
+  void Pke::FillEvent(const View& ev, double w) {
+    // Leading and subleading proton (defined by highest KE)
+    float KElead, KEsub;
+    kinematics::ProtonKE(ev.FinalState(), KElead, KEsub);
+    FillHist(KElead, KEsub, w);
   }
-  #endif
 
-  void Pke::Fill(const NuisTree& nuistr) {
-
-    // Loop through final-state particles and find leading and subleading proton (defined by highest KE)
-    float KElead = 0;
-    float KEsub = 0;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i] == 2212){
-          float ke = nuistr.fsp_E[i] - 0.938;
-          if (ke > KEsub){
-            if (ke > KElead){
-              KEsub = KElead;
-              KElead = ke;
-            }
-            else{
-              KEsub = ke;
-            }
-          }
-      }
-    }
+  #ifdef __LARSOFT__
+  void Pke::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH2F*>(hist)->Fill(KElead, KEsub, nuistr.Weight);
-  }
+  void Pke::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
   PPLead::PPLead(std::string _name, Filter* _filter)
       : Distribution(_name, _filter) {
@@ -843,52 +858,21 @@ namespace distributions {
                     20, 0, 2);
   }
 
-  #ifdef __LARSOFT__
-  void PPLead::Fill(const simb::MCTruth& truth, float w) {
-    float plead = 0;
-    int nprot = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (p.PdgCode() == 2212) {
-        nprot++;
-        if (p.P() > plead) {
-          plead = p.P();
-        }
-      }
-    }
-
-    if (nprot>0){
-      dynamic_cast<TH1F*>(hist)->Fill(plead, w);
+  template <class View>
+  void PPLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, [](int pdg, float) { return pdg == 2212; }, n);
+    if (n > 0) {
+      FillHist(fs.p[i], w);
     }
   }
-  #endif
-
-  void PPLead::Fill(const NuisTree& nuistr) {
 
-    // Loop through final-state particles and find leading proton (defined by highest KE)
-    float plead = 0;
-    int nprot = 0;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i] == 2212){
-        nprot++;
-        TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-        float p = pv.Mag();
-        if (p > plead){
-          plead = p;
-        }
-      }
-    }
+  #ifdef __LARSOFT__
+  void PPLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    if (nprot>0){
-      dynamic_cast<TH1F*>(hist)->Fill(plead, nuistr.Weight);
-    }
-  }
+  void PPLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ThetaPLead::ThetaPLead(std::string _name, Filter* _filter, float _ethreshold)
@@ -901,57 +885,21 @@ namespace distributions {
                     50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ThetaPLead::Fill(const simb::MCTruth& truth, float w) {
-    size_t np = 0;
-    float plead = 0;
-    float ctlead = 0;
+  template <class View>
+  void ThetaPLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::ProtonAbove{ethreshold}, n);
+    if (n > 0) {
+      FillHist(fs.costheta[i], w);
+    }
+  }
 
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (p.PdgCode() == 2212 && (p.E() - 0.938272) > ethreshold) {
-        np++;
-        if (p.P() > plead) {
-          plead = p.P();
-          ctlead = cos(p.Momentum().Theta());
-        }
-      }
-    }
-
-    if (np > 0) {
-      dynamic_cast<TH1F*>(hist)->Fill(ctlead, w);
-    }
-  }
+  #ifdef __LARSOFT__
+  void ThetaPLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void ThetaPLead::Fill(const NuisTree& nuistr) {
-
-      size_t np = 0;
-      float plead = 0;
-      float ctlead = 0;
-
-      for (int i=0; i<nuistr.nfsp; i++) {
-
-        if (nuistr.fsp_pdg[i] == 2212 && (nuistr.fsp_E[i] - 0.938272) > ethreshold) {
-          np++;
-          TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-          float p = pv.Mag();
-          if (p > plead) {
-            plead = p;
-            ctlead = cos(pv.Theta());
-          }
-        }
-      }
-
-      if (np > 0) {
-        dynamic_cast<TH1F*>(hist)->Fill(ctlead, nuistr.Weight);
-      }
-  }
+  void ThetaPLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ThetaLepPLead::ThetaLepPLead(std::string _name, Filter* _filter, float _ethreshold)
@@ -964,72 +912,21 @@ namespace distributions {
                     50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ThetaLepPLead::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCParticle& lep = truth.GetNeutrino().Lepton();
-
-    size_t np = 0;
-    float plead = 0;
-    float ctlep = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (p.PdgCode() == 2212 && (p.E() - 0.938272) > ethreshold) {
-        np++;
-        if (p.P() > plead) {
-          plead = p.P();
-          ctlep = cos(lep.Momentum().Vect().Angle(p.Momentum().Vect()));
-        }
-      }
-    }
-
-    if (np > 0) {
-      dynamic_cast<TH1F*>(hist)->Fill(ctlep, w);
+  template <class View>
+  void ThetaLepPLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::ProtonAbove{ethreshold}, n);
+    if (n > 0) {
+      FillHist(kinematics::CosAngle(ev.Lepton(), fs, i), w);
     }
   }
-  #endif
 
-  void ThetaLepPLead::Fill(const NuisTree& nuistr) {
-
-      size_t np = 0;
-      float plead = 0;
-      float ctlep = 0;
-      int i_lep = -999;
-      int i_leadingp = -999;
-
-      for (int i=0; i<nuistr.nfsp; i++) {
-
-        // Find lepton
-        if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-          // check this is the only lepton we've found
-          assert(i_lep==-999);
-          i_lep = i;
-        }
-
-        // Find leading proton (above threshold)
-        if (nuistr.fsp_pdg[i] == 2212 && (nuistr.fsp_E[i] - 0.938272) > ethreshold) {
-          np++;
-          TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-          float p = pv.Mag();
-          if (p > plead) {
-            plead = p;
-            i_leadingp = i;
-          }
-        }
-      }
+  #ifdef __LARSOFT__
+  void ThetaLepPLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-      if (np > 0) {
-        TVector3 pv_lep(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]);
-        TVector3 pv_leadingp(nuistr.fsp_px[i_leadingp],nuistr.fsp_py[i_leadingp],nuistr.fsp_pz[i_leadingp]);
-        ctlep = cos(pv_lep.Angle(pv_leadingp));
-        dynamic_cast<TH1F*>(hist)->Fill(ctlep, nuistr.Weight);
-      }
-  }
+  void ThetaLepPLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   dPhiLepPLead::dPhiLepPLead(std::string _name, Filter* _filter, float _ethreshold)
@@ -1042,121 +939,149 @@ namespace distributions {
                     20, -1, 1);
   }
 
+  template <class View>
+  void dPhiLepPLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::ProtonAbove{ethreshold}, n);
+    if (n > 0) {
+      FillHist(kinematics::DeltaPhi(ev.Lepton(), fs, i), w);
+    }
+  }
+
   #ifdef __LARSOFT__
-  void dPhiLepPLead::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCParticle& lep = truth.GetNeutrino().Lepton();
+  void dPhiLepPLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    size_t np = 0;
-    float plead = 0;
-    float dphilep = 0;
+  void dPhiLepPLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
 
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (p.PdgCode() == 2212 && (p.E() - 0.938272) > ethreshold) {
-        np++;
-        if (p.P() > plead) {
-          plead = p.P();
-          dphilep = lep.Momentum().Vect().DeltaPhi(p.Momentum().Vect());
-        }
-      }
-    }
+  Mult::Mult(std::string _name, Filter* _filter, int _pdg, float _ethreshold)
+      : Distribution(_name, _filter), pdg(_pdg), ethreshold(_ethreshold) {
+    char spdg[100];
+    snprintf(spdg, 100, "%i", pdg);
+    title = std::string("Multiplicity, PDG ") + spdg + ", " + _filter->title;
+    std::string hname = std::string("hmult_") + spdg + "_" + name;
+    hist = new TH1F(hname.c_str(), (title + ";N_{" + spdg + "}").c_str(), 20, 0, 20);
+  }
 
-    if (np > 0) {
-      dynamic_cast<TH1F*>(hist)->Fill(dphilep, w);
-    }
+  template <class View>
+  void Mult::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::Count(ev.FinalState(), pdg, ethreshold), w);
   }
+
+  #ifdef __LARSOFT__
+  void Mult::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void dPhiLepPLead::Fill(const NuisTree& nuistr) {
+  void Mult::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-      size_t np = 0;
-      float plead = 0;
-      float dphilep = 0;
-      int i_lep = -999;
-      int i_leadingp = -999;
 
-      for (int i=0; i<nuistr.nfsp; i++) {
+  void MultGroup::EnableChannels(const EventWeights* _weights) {
+    for (Mult* mult : mults) mult->EnableChannels(_weights);
+  }
 
-        // Find lepton
-        if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-          // check this is the only lepton we've found
-          assert(i_lep==-999);
-          i_lep = i;
-        }
+  void MultGroup::Merge(const Distribution& other) {
+    const MultGroup& group = dynamic_cast<const MultGroup&>(other);
+    for (size_t j=0; j<mults.size(); j++) mults[j]->Merge(*group.mults[j]);
+  }
 
-        // Find leading proton (above threshold)
-        if (nuistr.fsp_pdg[i] == 2212 && (nuistr.fsp_E[i] - 0.938272) > ethreshold) {
-          np++;
-          TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-          float p = pv.Mag();
-          if (p > plead) {
-            plead = p;
-            i_leadingp = i;
-          }
-        }
-      }
+  void MultGroup::Write() {
+    for (Mult* mult : mults) mult->Write();
+  }
 
-      if (np > 0) {
-        TVector3 pv_lep(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]);
-        TVector3 pv_leadingp(nuistr.fsp_px[i_leadingp],nuistr.fsp_py[i_leadingp],nuistr.fsp_pz[i_leadingp]);
-        dphilep = pv_lep.DeltaPhi(pv_leadingp);
-        dynamic_cast<TH1F*>(hist)->Fill(dphilep, nuistr.Weight);
-      }
+  void MultGroup::Save(TCanvas* c) {
+    for (Mult* mult : mults) mult->Save(c);
   }
 
 
-  Mult::Mult(std::string _name, Filter* _filter, int _pdg, float _ethreshold)
-      : Distribution(_name, _filter), pdg(_pdg), ethreshold(_ethreshold) {
-    char spdg[100];
-    snprintf(spdg, 100, "%i", pdg);
-    title = std::string("Multiplicity, PDG ") + spdg + ", " + _filter->title;
-    std::string hname = std::string("hmult_") + spdg + "_" + name;
-    hist = new TH1F(hname.c_str(), (title + ";N_{" + spdg + "}").c_str(), 20, 0, 20);
+  MultScan::MultScan(std::string _name, Filter* _filter, int _pdg,
+                     float _step, float _max)
+      : MultGroup(_name, _filter), pdg(_pdg) {
+    title = std::string("Multiplicity threshold scan, ") + _filter->title;
+    for (int i=0; i*_step <= _max + 1e-6; i++) {
+      float threshold = i * _step;
+      char smev[100];
+      snprintf(smev, 100, "_%iMeV", (int)std::lround(threshold * 1000));
+      mults.push_back(new Mult(name + smev, _filter, pdg, threshold));
+      thresholds.push_back(threshold);
+    }
+    counts.resize(thresholds.size());
+    hist = mults[0]->hist;
+  }
+
+  template <class View>
+  void MultScan::FillEvent(const View& ev, double w) {
+    Count(ev.FinalState());
+    for (size_t j=0; j<thresholds.size(); j++) {
+      mults[j]->FillHist(counts[j], w);
+    }
   }
 
   #ifdef __LARSOFT__
-  void Mult::Fill(const simb::MCTruth& truth, float w) {
-    size_t nf = 0;
-    mass = TDatabasePDG::Instance()->GetParticle(pdg)->Mass();
+  void MultScan::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-      if (p.PdgCode() == pdg && p.StatusCode() == genie::kIStStableFinalState && (p.E() - mass) > ethreshold) {
-        nf++;
+  void MultScan::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
+
+  void MultScan::Count(const ParticleSpan& fs) {
+    ke.clear();
+    for (int i=0; i<fs.n; i++) {
+      if (fs.pdg[i] == pdg) {
+        ke.push_back(fs.ke[i]);
       }
     }
+    std::sort(ke.begin(), ke.end());
+
+    // Count the particles above each threshold in one walk up the sorted KEs
+    size_t nbelow = 0;
+    for (size_t j=0; j<thresholds.size(); j++) {
+      while (nbelow < ke.size() && ke[nbelow] <= thresholds[j]) nbelow++;
+      counts[j] = ke.size() - nbelow;
+    }
+  }
+
+
 
-    dynamic_cast<TH1F*>(hist)->Fill(nf, w);
+  MultSet::MultSet(std::string _prefix, Filter* _filter)
+      : MultGroup(_prefix + "_mult", _filter), slots(kSlotMask + 1, -1) {
+    title = std::string("Multiplicities, ") + _filter->title;
+    const std::pair<const char*, int> species[] = {
+      {"p", 2212}, {"n", 2112}, {"pip", 211}, {"pim", -211},
+      {"pi0", 111}, {"kp", 321}, {"km", -321}, {"k0", 311}
+    };
+    for (const auto& s : species) {
+      // Each species needs its own table entry
+      assert(slots[s.second & kSlotMask] == -1);
+      slots[s.second & kSlotMask] = mults.size();
+      mults.push_back(new Mult(_prefix + "_mult" + s.first, _filter, s.second));
+    }
+    counts.resize(mults.size());
+    hist = mults[0]->hist;
   }
+
+  template <class View>
+  void MultSet::FillEvent(const View& ev, double w) {
+    Count(ev.FinalState());
+    for (size_t s=0; s<mults.size(); s++) {
+      mults[s]->FillHist(counts[s], w);
+    }
+  }
+
+  #ifdef __LARSOFT__
+  void MultSet::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
   #endif
 
-  void Mult::Fill(const NuisTree& nuistr) {
-    size_t nf = 0;
-    if (TMath::Abs(pdg) == 13) mass = 0.105658; // muon
-    else if (TMath::Abs(pdg) == 11) mass = 0.000510; // electron
-    else if (pdg == 311) mass = 0.497648; // k0
-    else if (TMath::Abs(pdg) == 321) mass = 0.493677; // k+/-
-    else if (pdg == 111) mass = 0.134977; // pi0
-    else if (TMath::Abs(pdg) == 211) mass = 0.139570; // pi+/-
-    else if (pdg == 2112) mass = 0.939565; // neutron
-    else if (pdg == 2212) mass = 0.938272; // proton
-    else{
-      std::cout << "Error: could not assign mass for particle with pdg " << pdg << ". Setting mass to 0 - this will mess up any thresholding you try to apply!" << std::endl;
-      mass = 0;
-    }\
+  void MultSet::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (nuistr.fsp_pdg[i] == pdg && (nuistr.fsp_E[i] - mass) > ethreshold){
-        nf++;
+  void MultSet::Count(const ParticleSpan& fs) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int i=0; i<fs.n; i++) {
+      int s = Slot(fs.pdg[i]);
+      if (s >= 0 && fs.ke[i] > 0) {
+        counts[s]++;
       }
     }
-
-    dynamic_cast<TH1F*>(hist)->Fill(nf, nuistr.Weight);
   }
 
 
@@ -1169,38 +1094,16 @@ namespace distributions {
     hist = new TH1F(hname.c_str(), (title + ";N_{" + spdg + "}").c_str(), 20, 0, 20);
   }
 
-  #ifdef __LARSOFT__
-  void IMult::Fill(const simb::MCTruth& truth, float w) {
-    size_t nf = -999;
-
-    assert(pdg == 2212 || pdg == 2112 || pdg == 211 || pdg == -211 || pdg ==111);
-
-    for (int i=0; i<truth.NParticles(); i++){
-      const simb::MCParticle &p = truth.GetParticle(i);
-      if (p.PdgCode() == pdg && p.StatusCode() == genie::kIStHadronInTheNucleus){
-	nf++;
-      }
-    }
-
-    dynamic_cast<TH1F*>(hist)->Fill(nf, w);
+  template <class View>
+  void IMult::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::IntermediateCount(ev, pdg), w);
   }
-  #endif
-
-  void IMult::Fill(const NuisTree& nuistr) {
-
-    // Nuisance tree gives "vertex particles" -- not sure but assuming this is the same thing as intermediate particles
-    // Actually, have recently found that Nuisance "vertex particles" might have a bug. Comenting this out and just filling with -999 to avoid confusion. If we decide we need this, may have to go back and check nuisance code first.
-
-    size_t nf = -999;
 
-    // for (int i=0; i<nuistr.nvertp; i++){
-    //   if (nuistr.vertp_pdg[i] == pdg){
-    //     nf++;
-    //   }
-    // }
+  #ifdef __LARSOFT__
+  void IMult::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(nf, nuistr.Weight);
-  }
+  void IMult::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   PPiLead::PPiLead(std::string _name, Filter* _filter, bool _charged)
@@ -1212,44 +1115,19 @@ namespace distributions {
                     20, 0, 2);
   }
 
-  #ifdef __LARSOFT__
-  void PPiLead::Fill(const simb::MCTruth& truth, float w) {
-    float plead = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (abs(p.PdgCode()) == 211 || (!charged && p.PdgCode() == 111)) {
-        if (p.P() > plead) {
-          plead = p.P();
-        }
-      }
-    }
-
-    dynamic_cast<TH1F*>(hist)->Fill(plead, w);
+  template <class View>
+  void PPiLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::Pion{charged}, n);
+    FillHist(i >= 0 ? fs.p[i] : 0, w);
   }
-  #endif
-
-  void PPiLead::Fill(const NuisTree& nuistr) {
 
-    // Loop through final-state particles and find leading proton (defined by highest KE)
-    float plead = 0;
-    for (int i=0; i<nuistr.nfsp; i++){
-      if (abs(nuistr.fsp_pdg[i]) == 211 || (!charged && nuistr.fsp_pdg[i] == 111)){
-        TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-        float p = pv.Mag();
-        if (p > plead){
-          plead = p;
-        }
-      }
-    }
+  #ifdef __LARSOFT__
+  void PPiLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(plead, nuistr.Weight);
-  }
+  void PPiLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ThetaPiLead::ThetaPiLead(std::string _name, Filter* _filter, bool _charged)
@@ -1261,57 +1139,21 @@ namespace distributions {
                     50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ThetaPiLead::Fill(const simb::MCTruth& truth, float w) {
-    size_t npi = 0;
-    float plead = 0;
-    float ctlead = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (abs(p.PdgCode()) == 211 || (!charged && p.PdgCode() == 111)) {
-        npi++;
-        if (p.P() > plead) {
-          plead = p.P();
-          ctlead = cos(p.Momentum().Theta());
-        }
-      }
-    }
-
-    if (npi > 0) {
-      dynamic_cast<TH1F*>(hist)->Fill(ctlead, w);
+  template <class View>
+  void ThetaPiLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::Pion{charged}, n);
+    if (n > 0) {
+      FillHist(fs.costheta[i], w);
     }
   }
-  #endif
 
-  void ThetaPiLead::Fill(const NuisTree& nuistr) {
-
-      size_t npi = 0;
-      float plead = 0;
-      float ctlead = 0;
-
-      for (int i=0; i<nuistr.nfsp; i++) {
-
-        if (abs(nuistr.fsp_pdg[i]) == 211 || (!charged && nuistr.fsp_pdg[i] == 111)) {
-          npi++;
-          TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-          float p = pv.Mag();
-          if (p > plead) {
-            plead = p;
-            ctlead = cos(pv.Theta());
-          }
-        }
-      }
+  #ifdef __LARSOFT__
+  void ThetaPiLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-      if (npi > 0) {
-        dynamic_cast<TH1F*>(hist)->Fill(ctlead, nuistr.Weight);
-      }
-  }
+  void ThetaPiLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ThetaLepPiLead::ThetaLepPiLead(std::string _name, Filter* _filter, bool _charged)
@@ -1323,72 +1165,21 @@ namespace distributions {
                     50, -1, 1);
   }
 
-  #ifdef __LARSOFT__
-  void ThetaLepPiLead::Fill(const simb::MCTruth& truth, float w) {
-    const simb::MCParticle& lep = truth.GetNeutrino().Lepton();
-
-    size_t npi = 0;
-    float plead = 0;
-    float ctlep = 0;
-
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      if (abs(p.PdgCode()) == 211 || (!charged && p.PdgCode() == 111)) {
-        npi++;
-        if (p.P() > plead) {
-          plead = p.P();
-          ctlep = cos(lep.Momentum().Vect().Angle(p.Momentum().Vect()));
-        }
-      }
-    }
-
-    if (npi > 0) {
-      dynamic_cast<TH1F*>(hist)->Fill(ctlep, w);
+  template <class View>
+  void ThetaLepPiLead::FillEvent(const View& ev, double w) {
+    ParticleSpan fs = ev.FinalState();
+    size_t n;
+    int i = kinematics::Leading(fs, kinematics::Pion{charged}, n);
+    if (n > 0) {
+      FillHist(kinematics::CosAngle(ev.Lepton(), fs, i), w);
     }
   }
-  #endif
-
-  void ThetaLepPiLead::Fill(const NuisTree& nuistr) {
-
-      size_t npi = 0;
-      float plead = 0;
-      float ctlep = 0;
-      int i_lep = -999;
-      int i_leadingpi = -999;
-
-      for (int i=0; i<nuistr.nfsp; i++) {
 
-        // Find lepton
-        if (nuistr.fsp_pdg[i]==nuistr.PDGLep && nuistr.fsp_E[i]==nuistr.ELep){
-          // check this is the only lepton we've found
-          assert(i_lep==-999);
-          i_lep = i;
-        }
-
-        // Find leading pion
-        if (abs(nuistr.fsp_pdg[i]) == 211 || (!charged && nuistr.fsp_pdg[i] == 111)) {
-          npi++;
-          TVector3 pv(nuistr.fsp_px[i],nuistr.fsp_py[i],nuistr.fsp_pz[i]);
-          float p = pv.Mag();
-          if (p > plead) {
-            plead = p;
-            i_leadingpi = i;
-          }
-        }
-      }
+  #ifdef __LARSOFT__
+  void ThetaLepPiLead::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-      if (npi > 0) {
-        TVector3 pv_lep(nuistr.fsp_px[i_lep],nuistr.fsp_py[i_lep],nuistr.fsp_pz[i_lep]);
-        TVector3 pv_leadingpi(nuistr.fsp_px[i_leadingpi],nuistr.fsp_py[i_leadingpi],nuistr.fsp_pz[i_leadingpi]);
-        ctlep = cos(pv_lep.Angle(pv_leadingpi));
-        dynamic_cast<TH1F*>(hist)->Fill(ctlep, nuistr.Weight);
-      }
-  }
+  void ThetaLepPiLead::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 
   ECons::ECons(std::string _name, Filter* _filter)
@@ -1400,104 +1191,15 @@ namespace distributions {
                     50, -2.5, 2.5);
   }
 
-  #ifdef __LARSOFT__
-  void ECons::Fill(const simb::MCTruth& truth, float w) {
-    float pmass = TDatabasePDG::Instance()->GetParticle(2212)->Mass();
-    float nmass = TDatabasePDG::Instance()->GetParticle(2112)->Mass();
-
-    //// Initial state
-    const simb::MCNeutrino& nu = truth.GetNeutrino();
-
-    // Neutrino energy
-    float enu = nu.Nu().E();
-
-    // Target nucleus rest mass
-    float tgtmass;
-    int tgtpdg = nu.Target();
-    TParticlePDG* tgtparticle = TDatabasePDG::Instance()->GetParticle(tgtpdg);
-    if (tgtparticle) {
-      tgtmass = tgtparticle->Mass();
-    }
-    else {
-      int tgtZ = IonPdgCodeToZ(tgtpdg);
-      int tgtA = IonPdgCodeToA(tgtpdg);
-
-      tgtmass = tgtZ * pmass + (tgtA - tgtZ) * nmass;
-    }
-
-    // Struck nucleon KE
-    // Get the struck nucleon from the particle stack
-    // Check particle 2 - if status code == 11, this is the struck nucleon
-    // If status code != 11, we are looking at an interaction with a free nucleon, which will be saved by GENIE as particle 1
-    int i_nuc = -999;
-    if (truth.GetParticle(2).StatusCode() == 11){
-      i_nuc = 2;
-    }
-    else{
-      i_nuc = 1;
-    }
-    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
-    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
-
-    float nucmass = TDatabasePDG::Instance()->GetParticle(nuc_pdg)->Mass();
-    float enuc = truth.GetParticle(i_nuc).Momentum().E() - nucmass;
-
-    // Total
-    float ei = enu + tgtmass + enuc;
-
-    //// Final state
-    // Lepton total energy
-    float elep = nu.Lepton().E();
-
-    // Nuclear remnant rest mass
-    float remnantmass = 0;
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-      if (p.StatusCode() != genie::kIStFinalStateNuclearRemnant) {
-        continue;
-      }
-      TParticlePDG* rpart = TDatabasePDG::Instance()->GetParticle(p.PdgCode());
-      if (rpart) {
-        remnantmass += tgtparticle->Mass();
-      }
-      else {
-        int a = IonPdgCodeToA(p.PdgCode());
-        int z = IonPdgCodeToZ(p.PdgCode());
-        remnantmass += z * pmass + (a - z) * nmass;
-      }
-    }
-
-    // Final state hadrons
-    float ehad = 0;
-    for (int i=0; i<truth.NParticles(); i++) {
-      const simb::MCParticle& p = truth.GetParticle(i);
-
-      if (p.StatusCode() != genie::kIStStableFinalState) {
-        continue;
-      }
-
-      TParticlePDG* particle = TDatabasePDG::Instance()->GetParticle(p.PdgCode());
-      assert(particle || p.PdgCode() == 2000000101);
-      float mass = particle ? particle->Mass() : 0;
-
-      ehad += p.E() - mass;
-    }
-
-    // Total
-    float ef = elep + remnantmass + ehad;
-
-    // Balance
-    float de = ei-ef;
-
-    dynamic_cast<TH1F*>(hist)->Fill(de, w);
+  template <class View>
+  void ECons::FillEvent(const View& ev, double w) {
+    FillHist(kinematics::EnergyBalance(ev), w);
   }
-  #endif
 
-  void ECons::Fill(const NuisTree& nuistr) {
-    // It's not clear that we can recreate this plot with NUISANCE trees (and I'm worried that if we try we will end up with inconsistencies of O(binding energy) with the GENIE implementation that could cause a lot of confusion) so don't try. Just fill with 0s -- if we need to make a similar plot to this in the future, can think through exactly what we want to show and whether that's possible to implement with the NUISANCE trees
-    float de = 0;
+  #ifdef __LARSOFT__
+  void ECons::Fill(const TruthView& ev, float w) { FillEvent(ev, w); }
+  #endif
 
-    dynamic_cast<TH1F*>(hist)->Fill(de, nuistr.Weight);
-  }
+  void ECons::Fill(const NuisTree& nuistr) { FillEvent(NuisView(nuistr), nuistr.Weight); }
 
 }  // namespace distributions
@@ -7,8 +7,13 @@
  * A. Mastbaum <mastbaum@uchicago.edu>, 2018/12/19
  */
 
+#include <memory>
 #include <string>
+#include <vector>
 #include "NuisTree.h"
+#include "binsums.h"
+#include "sparsehist.h"
+#include "weights.h"
 #ifdef __LARSOFT__
 #include "nusimdata/SimulationBase/GTruth.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
@@ -18,8 +23,12 @@
 #endif
 
 class Filter;
+struct ParticleSpan;
 class TCanvas;
 class TH1;
+#ifdef __LARSOFT__
+class TruthView;
+#endif
 
 /**
  * \class Distribution
@@ -31,28 +40,103 @@ class TH1;
 struct Distribution {
   /** Constructor. */
   Distribution(std::string _name, Filter* _filter)
-      : filter(_filter), name(_name) {}
+      : filter(_filter), name(_name), capture(nullptr), weights(nullptr) {}
 
   /** Constructor. */
   Distribution(std::string _name, std::string _title,
                TH1* _hist, Filter* _filter);
 
-  /** Fill the distribution histogram */
+  /**
+   * Fill the distribution histogram. Gallery events are filled from a view
+   * of each MCTruth (eventview.h), built once and shared by all the
+   * distributions. Each distribution fills both through one FillEvent
+   * template on the event view, ending in FillHist, so the gallery and
+   * NUISANCE fills accumulate the same way.
+   */
   #ifdef __LARSOFT__
-  virtual void Fill(const simb::MCTruth& truth, float w=1.0) = 0;
+  virtual void Fill(const TruthView& ev, float w=1.0) = 0;
   #endif
   virtual void Fill(const NuisTree& nuistr) = 0;
 
-  /** Write to a ROOT file. */
-  void Write();
-
-  /** Plot and save to a PDF. */
-  void Save(TCanvas* c=NULL);
+  /**
+   * Also fill every channel of the given weights, bin by bin alongside the
+   * histogram. Channels are filled by FillHist.
+   */
+  virtual void EnableChannels(const EventWeights* _weights);
+
+  /** Add the histogram contents of another copy of this distribution. */
+  virtual void Merge(const Distribution& other);
+
+  /**
+   * Write to a ROOT file (with the weight channel summaries, if any).
+   * Empty histograms are skipped.
+   */
+  virtual void Write();
+
+  /** Plot and save to a PDF. Empty histograms are skipped. */
+  virtual void Save(TCanvas* c=NULL);
+
+  /**
+   * Record the values of the variables instead of filling the histogram:
+   * FillHist stores x (and y, for 2D) in values[0] (and values[1]).
+   * Used to export the variables (see make_ntuple).
+   */
+  void SetCapture(float* values) { capture = values; }
+
+  /**
+   * Accumulate the fills in external cells (in a BinArena) rather than in
+   * sums allocated on the first fill. Call before filling.
+   *
+   * \param bins hist->GetNcells() zeroed cells
+   * \param nentries Where to count fills
+   */
+  void UseSums(BinSums::Bin* bins, double* nentries);
+
+  /** Number of weight channel sums (0 without EnableChannels). */
+  size_t ChannelSize() const { return channels ? channels->size() : 0; }
+
+  /**
+   * Accumulate the weight channels in external cells (in a BinArena). Call
+   * after EnableChannels, before filling.
+   *
+   * \param cells ChannelSize() zeroed sums
+   */
+  void UseChannels(double* cells);
+
+  /**
+   * Fill a 1D histogram with a weight, and the weight channels. The weight
+   * goes to double precision sums (BinSums), copied into the histogram when
+   * it is written.
+   */
+  void FillHist(double x, double w);
+
+  /** Fill a 2D histogram with a weight, and the weight channels. */
+  void FillHist(double x, double y, double w);
+
+  /** Fill a 1D histogram with the event weight, and the weight channels. */
+  void FillHist(const NuisTree& nuistr, double x) { FillHist(x, nuistr.Weight); }
+
+  /** Fill a 2D histogram with the event weight, and the weight channels. */
+  void FillHist(const NuisTree& nuistr, double x, double y) { FillHist(x, y, nuistr.Weight); }
 
   TH1* hist;  //!< A generic ROOT histogram
   Filter* filter;  //!< The event filter function
   std::string name;  //!< Distribution name
   std::string title;  //!< Distribution ROOT/LaTeX title
+
+protected:
+  float* capture;  //!< Where to record values instead of filling, if set
+
+  /** Copy the accumulated sums into the histogram, if any fills went through FillHist. */
+  void Flush();
+
+  /** Write the channel histograms for one set of sums (all events or one slice). */
+  void WriteChannels(const std::string& hname, const std::string& htitle,
+                     const std::vector<double>& sums);
+
+  const EventWeights* weights;  //!< Channel weights of the current event
+  std::unique_ptr<WeightChannels> channels;  //!< Per-bin channel sums
+  std::unique_ptr<BinSums> sums;  //!< Per-bin sums of the event weight
 };
 
 
@@ -62,9 +146,10 @@ namespace distributions {
   struct Q2 : public Distribution {
     Q2(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-      void Fill(const simb::MCTruth& truth, float w=1.0);
+      void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -72,18 +157,20 @@ namespace distributions {
   struct TheoristsW : public Distribution {
     TheoristsW(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
   /** Experimentalists' W distribution, W = sqrt(M^2 + 2*M*q0 - Q^2) (where M is the mass of the hit nucleon, q0 = Enu-Elep, q is the 4-momentum pnu-plep, and Q^2 = -q.q) */
   struct ExperimentalistsW : public Distribution {
     ExperimentalistsW(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -91,9 +178,10 @@ namespace distributions {
   struct TheoristsBjorkenX : public Distribution {
     TheoristsBjorkenX(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -101,9 +189,10 @@ namespace distributions {
   struct ExperimentalistsBjorkenX : public Distribution {
     ExperimentalistsBjorkenX(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -111,9 +200,10 @@ namespace distributions {
   struct TheoristsInelasticityY : public Distribution {
     TheoristsInelasticityY(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -121,9 +211,10 @@ namespace distributions {
   struct ExperimentalistsInelasticityY : public Distribution {
     ExperimentalistsInelasticityY(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -131,9 +222,10 @@ namespace distributions {
   struct TheoristsNu : public Distribution {
     TheoristsNu(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -141,9 +233,10 @@ namespace distributions {
   struct ExperimentalistsNu : public Distribution {
     ExperimentalistsNu(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -151,9 +244,10 @@ namespace distributions {
   struct BindingE : public Distribution {
     BindingE(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -161,9 +255,10 @@ namespace distributions {
   struct PLep : public Distribution {
     PLep(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -171,9 +266,10 @@ namespace distributions {
   struct ThetaLep : public Distribution {
     ThetaLep(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -181,9 +277,35 @@ namespace distributions {
   struct Q0Q3 : public Distribution {
     Q0Q3(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
+  };
+
+
+  /**
+   * q0/q3 distribution, kept at fine resolution in q0 x q3 x Enu.
+   *
+   * Events are filled into a sparse 3D histogram (see sparsehist.h), and
+   * the q0/q3 plot (as for Q0Q3, with the same name) is projected from it at
+   * write time. The full histogram is also written, as a THnSparseD named
+   * "<hist>_nd", for projections with other binnings or Enu ranges.
+   *
+   * \param _resolution Bin width on every axis (GeV); should divide the q0/q3 plot's 25 MeV bins
+   * \param _enumax Largest Enu (GeV)
+   */
+  struct Q0Q3Enu : public Distribution {
+    Q0Q3Enu(std::string _name, Filter* _filter, float _resolution=0.005, float _enumax=10);
+    #ifdef __LARSOFT__
+    void Fill(const TruthView& ev, float w=1.0);
+    #endif
+    void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
+    void Merge(const Distribution& other);
+    void Write();
+    void Save(TCanvas* c=NULL);
+    std::unique_ptr<SparseHist> sparse;  //!< q3 x q0 x Enu
   };
 
 
@@ -191,9 +313,10 @@ namespace distributions {
   struct PThetaLep : public Distribution {
     PThetaLep(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -201,9 +324,10 @@ namespace distributions {
   struct LeadPKEQ0 : public Distribution {
     LeadPKEQ0(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -211,9 +335,10 @@ namespace distributions {
   struct Pke : public Distribution {
     Pke(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -221,9 +346,10 @@ namespace distributions {
   struct ThetaPLead : public Distribution {
     ThetaPLead(std::string _name, Filter* _filter, float _ethreshold=0);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     float ethreshold;  //!< KE threshold (GeV)
   };
 
@@ -232,9 +358,10 @@ namespace distributions {
   struct PPLead : public Distribution {
     PPLead(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 
@@ -242,9 +369,10 @@ namespace distributions {
   struct ThetaLepPLead : public Distribution {
     ThetaLepPLead(std::string _name, Filter* _filter, float _ethreshold=0);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     float ethreshold;  //!< KE threshold (GeV)
   };
 
@@ -253,9 +381,10 @@ namespace distributions {
   struct dPhiLepPLead : public Distribution {
     dPhiLepPLead(std::string _name, Filter* _filter, float _ethreshold=0);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     float ethreshold;  //!< KE threshold (GeV)
   };
 
@@ -264,12 +393,86 @@ namespace distributions {
   struct Mult : public Distribution {
     Mult(std::string _name, Filter* _filter, int _pdg, float _ethreshold=0);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     int pdg;  //!< Particle PDG code
     float ethreshold;  //!< KE threshold (GeV)
-    float mass;  //!< Particle mass (from PDG database lookup)
+  };
+
+
+  /**
+   * A group of multiplicity distributions filled together (base class).
+   *
+   * Merging, writing and saving go to each multiplicity in turn.
+   */
+  struct MultGroup : public Distribution {
+    MultGroup(std::string _name, Filter* _filter) : Distribution(_name, _filter) {}
+    void EnableChannels(const EventWeights* _weights);
+    void Merge(const Distribution& other);
+    void Write();
+    void Save(TCanvas* c=NULL);
+    std::vector<Mult*> mults;  //!< The multiplicity distributions
+  };
+
+
+  /**
+   * Final state particle multiplicity for a scan of KE thresholds.
+   *
+   * Equivalent to one Mult per threshold, but the species' kinetic energies
+   * are sorted once per event and all thresholds are filled from a single
+   * walk over them. Each threshold is written as its own histogram, named
+   * as for Mult with the threshold appended (e.g. "hmult_2212_NAME_30MeV").
+   *
+   * \param _step Threshold step (GeV)
+   * \param _max Largest threshold (GeV)
+   */
+  struct MultScan : public MultGroup {
+    MultScan(std::string _name, Filter* _filter, int _pdg,
+             float _step=0.005, float _max=0.1);
+    #ifdef __LARSOFT__
+    void Fill(const TruthView& ev, float w=1.0);
+    #endif
+    void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
+    /** Count the particles above each threshold, into counts. */
+    void Count(const ParticleSpan& fs);
+    int pdg;  //!< Particle PDG code
+    std::vector<float> thresholds;  //!< KE thresholds (GeV), ascending
+    std::vector<float> ke;  //!< Kinetic energies in the current event
+    std::vector<size_t> counts;  //!< Counts in the current event, by threshold
+  };
+
+
+  /**
+   * Final state multiplicities of the standard species (p, n, pi+, pi-,
+   * pi0, K+, K-, K0) in one pass over the particle stack.
+   *
+   * Equivalent to one Mult per species, named "PREFIX_multp",
+   * "PREFIX_multn", "PREFIX_multpip", ... as in the plot set, but each
+   * particle is assigned to its species with a PDG to slot table lookup and
+   * all the counts are made in a single loop.
+   *
+   * \param _prefix Name prefix (e.g. "num_ccqe")
+   */
+  struct MultSet : public MultGroup {
+    MultSet(std::string _prefix, Filter* _filter);
+    #ifdef __LARSOFT__
+    void Fill(const TruthView& ev, float w=1.0);
+    #endif
+    void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
+    /** Count each species, into counts. */
+    void Count(const ParticleSpan& fs);
+    /** Slot of a PDG code, or -1 if not counted. */
+    int Slot(int pdg) const {
+      int s = slots[pdg & kSlotMask];
+      return (s >= 0 && mults[s]->pdg == pdg) ? s : -1;
+    }
+    static const int kSlotMask = 4095;
+    std::vector<signed char> slots;  //!< Slot by PDG code & kSlotMask
+    std::vector<size_t> counts;  //!< Counts in the current event, by slot
   };
 
 
@@ -277,9 +480,10 @@ namespace distributions {
   struct IMult : public Distribution {
     IMult(std::string _name, Filter* _filter, int _pdg);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     int pdg;  //!< Particle PDG code
   };
 
@@ -288,9 +492,10 @@ namespace distributions {
   struct PPiLead : public Distribution {
     PPiLead(std::string _name, Filter* _filter, bool _charged=false);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     bool charged;  //!< Consider only charged pions
   };
 
@@ -299,9 +504,10 @@ namespace distributions {
   struct ThetaPiLead : public Distribution {
     ThetaPiLead(std::string _name, Filter* _filter, bool _charged=false);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     bool charged;  //!< Consider only charged pions
   };
 
@@ -310,9 +516,10 @@ namespace distributions {
   struct ThetaLepPiLead : public Distribution {
     ThetaLepPiLead(std::string _name, Filter* _filter, bool _charged=false);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
     bool charged;  //!< Consider only charged pions
   };
 
@@ -321,9 +528,10 @@ namespace distributions {
   struct ECons : public Distribution {
     ECons(std::string _name, Filter* _filter);
     #ifdef __LARSOFT__
-    void Fill(const simb::MCTruth& truth, float w=1.0);
+    void Fill(const TruthView& ev, float w=1.0);
     #endif
     void Fill(const NuisTree& nuistr);
+    template <class View> void FillEvent(const View& ev, double w);
   };
 
 }  // namespace distributions
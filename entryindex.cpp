@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "TEntryList.h"
+#include "TFile.h"
+#include "filter.h"
+#include "entryindex.h"
+
+EntryIndex::EntryIndex(const std::string& _filename, const std::vector<Filter*>& _filters)
+    : filename(_filename), complete(false), recorded(_filters.size()) {
+  for (Filter* filter : _filters) {
+    keys.push_back(filter->Key());
+  }
+
+  {
+    TFile fin(filename.c_str(), "READ");
+    uuid = fin.GetUUID().AsString();
+  }
+
+  std::string sidecar = SidecarName(filename);
+  if (!std::ifstream(sidecar)) {
+    return;
+  }
+
+  std::unique_ptr<TFile> side(TFile::Open(sidecar.c_str(), "READ"));
+  if (!side || side->IsZombie()) {
+    return;
+  }
+
+  for (const std::string& key : keys) {
+    std::unique_ptr<TEntryList> list((TEntryList*)side->Get(key.c_str()));
+    if (!list || uuid != list->GetTitle()) {
+      entries.clear();
+      return;
+    }
+    list->SetDirectory(nullptr);
+    for (Long64_t i=0; i<list->GetN(); i++) {
+      entries.push_back(list->GetEntry(i));
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+  complete = true;
+
+  std::cout << "INDEX " << filename << ": " << entries.size()
+            << " entries pass the filters" << std::endl;
+}
+
+
+std::string EntryIndex::SidecarName(const std::string& filename) {
+  return filename + ".entrylists.root";
+}
+
+
+std::vector<std::pair<Long64_t, Long64_t> >
+EntryIndex::Restrict(const std::vector<std::pair<Long64_t, Long64_t> >& clusters) const {
+  std::vector<std::pair<Long64_t, Long64_t> > restricted;
+  for (const auto& cluster : clusters) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), cluster.first);
+    if (it != entries.end() && *it < cluster.second) {
+      restricted.push_back(cluster);
+    }
+  }
+  return restricted;
+}
+
+
+void EntryIndex::Add(const std::vector<std::vector<Long64_t> >& passed) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (size_t i=0; i<passed.size(); i++) {
+    recorded[i].insert(recorded[i].end(), passed[i].begin(), passed[i].end());
+  }
+}
+
+
+void EntryIndex::Write() {
+  std::string sidecar = SidecarName(filename);
+  TFile side(sidecar.c_str(), "UPDATE");
+  if (side.IsZombie()) {
+    std::cout << "Warning: cannot write entry lists to " << sidecar << std::endl;
+    return;
+  }
+
+  for (size_t i=0; i<keys.size(); i++) {
+    std::sort(recorded[i].begin(), recorded[i].end());
+    TEntryList list(keys[i].c_str(), uuid.c_str());
+    list.SetDirectory(nullptr);
+    for (Long64_t entry : recorded[i]) {
+      list.Enter(entry);
+    }
+    side.WriteTObject(&list, keys[i].c_str(), "Overwrite");
+  }
+  side.Close();
+
+  std::cout << "INDEX " << filename << ": wrote " << keys.size()
+            << " entry lists to " << sidecar << std::endl;
+}
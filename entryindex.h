@@ -0,0 +1,69 @@
+#ifndef __ENTRYINDEX__
+#define __ENTRYINDEX__
+
+/**
+ * Per-filter entry lists, persisted next to a NUISANCE file.
+ *
+ * In inclusive samples only a fraction of the entries pass any of the
+ * plotting filters. The first pass over a file records the passing entries
+ * of each filter in a sidecar ROOT file (INPUT.root.entrylists.root), as
+ * one TEntryList per filter. Lists are named by Filter::Key() and titled
+ * with the UUID of the input file they were made from, so a list is only
+ * reused for the same file and the same selection. Later passes read just
+ * the union of the lists and skip every other entry without reading it.
+ */
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Rtypes.h"
+
+class Filter;
+
+/**
+ * \class EntryIndex
+ * \brief Entry lists for a set of filters on one input file.
+ *
+ * \param _filename Input NUISANCE file name
+ * \param _filters Filters to index, all with a non-empty Key()
+ */
+class EntryIndex {
+public:
+  EntryIndex(const std::string& _filename, const std::vector<Filter*>& _filters);
+
+  /** Sidecar file name for an input file. */
+  static std::string SidecarName(const std::string& filename);
+
+  /** True if lists for all the filters were found for this input. */
+  bool IsComplete() const { return complete; }
+
+  /** Sorted entries passing at least one filter (if complete). */
+  const std::vector<Long64_t>& GetEntries() const { return entries; }
+
+  /** Drop the clusters holding no listed entries (if complete). */
+  std::vector<std::pair<Long64_t, Long64_t> >
+  Restrict(const std::vector<std::pair<Long64_t, Long64_t> >& clusters) const;
+
+  /**
+   * Record the entries passing each filter in one part of a pass over
+   * the file. Thread safe.
+   *
+   * \param passed Passing entries, per filter
+   */
+  void Add(const std::vector<std::vector<Long64_t> >& passed);
+
+  /** Write the recorded lists to the sidecar file. */
+  void Write();
+
+private:
+  std::string filename;  //!< Input file name
+  std::string uuid;  //!< UUID of the input file
+  std::vector<std::string> keys;  //!< Filter keys
+  bool complete;  //!< All lists were found
+  std::vector<Long64_t> entries;  //!< Union of the lists
+  std::vector<std::vector<Long64_t> > recorded;  //!< Entries recorded per filter
+  std::mutex mutex;
+};
+
+#endif  // __ENTRYINDEX__
@@ -0,0 +1,575 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "RZip.h"
+#include "NuisTree.h"
+#include "eventstore.h"
+
+namespace eventstore {
+
+  namespace {
+
+    const char kMagic[8] = "NUISEVS";
+    const uint32_t kVersion = 2;
+
+    // Largest chunk ROOT's zip routines handle in one call
+    const size_t kMaxZipChunk = 0xffffff;
+
+    // Blocks start on cache line boundaries, so mapped columns are aligned
+    const size_t kAlignment = 64;
+
+    // Columns, in file order
+    enum Column {
+      cMode, cPDGnu, cCC, cTgt, cPDGLep,
+      cFlagCC1pip, cFlagCC1pim, cFlagCC1pi0,
+      cEnu, cELep, cCosLep, cQ2, cQ0, cQ3, cY,
+      cWeight, cInputWeight, cRWWeight, cCustomWeight,
+      cFspPx, cFspPy, cFspPz, cFspE, cFspPdg,
+      cInitPx, cInitPy, cInitPz, cInitE, cInitPdg,
+      cFspOffset, cInitOffset,
+      kNColumns
+    };
+
+    struct Field {
+      const char* name;
+      Stack stack;
+      Encoding encoding;
+      bool momentum;  // Encoding can be chosen by the writer
+    };
+
+    const Field kSchema[kNColumns] = {
+      { "Mode", kEvent, kInt32, false },
+      { "PDGnu", kEvent, kInt32, false },
+      { "cc", kEvent, kInt8, false },
+      { "tgt", kEvent, kInt32, false },
+      { "PDGLep", kEvent, kInt32, false },
+      { "flagCC1pip", kEvent, kInt8, false },
+      { "flagCC1pim", kEvent, kInt8, false },
+      { "flagCC1pi0", kEvent, kInt8, false },
+      { "Enu_true", kEvent, kFloat32, false },
+      { "ELep", kEvent, kFloat32, false },
+      { "CosLep", kEvent, kFloat32, false },
+      { "Q2", kEvent, kFloat32, false },
+      { "q0", kEvent, kFloat32, false },
+      { "q3", kEvent, kFloat32, false },
+      { "y", kEvent, kFloat32, false },
+      { "Weight", kEvent, kFloat32, false },
+      { "InputWeight", kEvent, kFloat32, false },
+      { "RWWeight", kEvent, kFloat32, false },
+      { "CustomWeight", kEvent, kFloat32, false },
+      { "px", kFSP, kFloat32, true },
+      { "py", kFSP, kFloat32, true },
+      { "pz", kFSP, kFloat32, true },
+      { "E", kFSP, kFloat32, false },  // Kept exact: the lepton is matched on E == ELep
+      { "pdg", kFSP, kInt32, false },
+      { "px_init", kInit, kFloat32, true },
+      { "py_init", kInit, kFloat32, true },
+      { "pz_init", kInit, kFloat32, true },
+      { "E_init", kInit, kFloat32, false },
+      { "pdg_init", kInit, kInt32, false },
+      { "offset_fsp", kOffsets, kInt32, false },
+      { "offset_init", kOffsets, kInt32, false }
+    };
+
+    bool IsInteger(int encoding) {
+      return encoding == kInt32 || encoding == kInt8;
+    }
+
+    // IEEE 754 half precision conversions, with round-to-nearest-even
+    uint16_t FloatToHalf(float f) {
+      uint32_t x;
+      std::memcpy(&x, &f, sizeof(x));
+      uint32_t sign = (x >> 16) & 0x8000;
+      int32_t fexp = (x >> 23) & 0xff;
+      uint32_t mant = x & 0x7fffff;
+
+      if (fexp == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);  // inf/nan
+
+      int32_t exp = fexp - 127 + 15;
+      if (exp >= 31) return sign | 0x7c00;  // overflow to inf
+
+      if (exp <= 0) {  // subnormal half, or zero
+        if (exp < -10) return sign;
+        mant |= 0x800000;
+        uint32_t shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1))) h++;
+        return sign | h;
+      }
+
+      uint32_t h = (exp << 10) | (mant >> 13);
+      uint32_t rem = mant & 0x1fff;
+      if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;  // a carry correctly bumps the exponent
+      return sign | h;
+    }
+
+    float HalfToFloat(uint16_t h) {
+      uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+      uint32_t exp = (h >> 10) & 0x1f;
+      uint32_t mant = h & 0x3ff;
+      uint32_t x;
+
+      if (exp == 0) {
+        if (mant == 0) {
+          x = sign;
+        }
+        else {  // subnormal half: normalize
+          exp = 127 - 15 + 1;
+          while (!(mant & 0x400)) {
+            mant <<= 1;
+            exp--;
+          }
+          x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+        }
+      }
+      else if (exp == 31) {
+        x = sign | 0x7f800000 | (mant << 13);
+      }
+      else {
+        x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+      }
+
+      float f;
+      std::memcpy(&f, &x, sizeof(f));
+      return f;
+    }
+
+    // ROOT's zip entry point takes the algorithm as an enum whose type has
+    // changed between releases; deduce it from the function signature
+    template <typename Algorithm>
+    void Zip(void (*zip)(int, int*, char*, int*, char*, int*, Algorithm),
+             int level, int algorithm, int* srcsize, char* src,
+             int* tgtsize, char* tgt, int* irep) {
+      zip(level, srcsize, src, tgtsize, tgt, irep, static_cast<Algorithm>(algorithm));
+    }
+
+  }  // namespace
+
+
+  int ParseCodec(const std::string& name) {
+    if (name == "none") return kNone;
+    if (name == "zlib") return kZLIB;
+    if (name == "lz4") return kLZ4;
+    if (name == "zstd") return kZSTD;
+    return -1;
+  }
+
+
+  int ParseEncoding(const std::string& name) {
+    if (name == "float32") return kFloat32;
+    if (name == "float16") return kFloat16;
+    if (name == "quant16") return kQuant16;
+    return -1;
+  }
+
+}  // namespace eventstore
+
+
+using namespace eventstore;
+
+
+EventStoreWriter::EventStoreWriter(std::string _filename, int _codec,
+                                   int _level, int _momentum,
+                                   size_t _groupsize)
+    : out(_filename, std::ios::binary), codec(_codec), level(_level),
+      groupsize(_groupsize), nentries(0),
+      fbuf(kNColumns), ibuf(kNColumns) {
+  if (!out) {
+    throw std::runtime_error("EventStoreWriter: cannot open " + _filename);
+  }
+
+  for (size_t i=0; i<kNColumns; i++) {
+    ColumnInfo column;
+    std::memset(&column, 0, sizeof(column));
+    std::strncpy(column.name, kSchema[i].name, sizeof(column.name) - 1);
+    column.stack = kSchema[i].stack;
+    column.encoding = kSchema[i].momentum ? _momentum : kSchema[i].encoding;
+    column.codec = codec;
+    columns.push_back(column);
+  }
+
+  // Placeholder header, rewritten by Close()
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  out.write((const char*)&header, sizeof(header));
+
+  ibuf[cFspOffset].push_back(0);
+  ibuf[cInitOffset].push_back(0);
+}
+
+
+void EventStoreWriter::Fill(const NuisTree& nuistr) {
+  ibuf[cMode].push_back(nuistr.Mode);
+  ibuf[cPDGnu].push_back(nuistr.PDGnu);
+  ibuf[cCC].push_back(nuistr.iscc);
+  ibuf[cTgt].push_back(nuistr.tgt);
+  ibuf[cPDGLep].push_back(nuistr.PDGLep);
+  ibuf[cFlagCC1pip].push_back(nuistr.flagCC1pip);
+  ibuf[cFlagCC1pim].push_back(nuistr.flagCC1pim);
+  ibuf[cFlagCC1pi0].push_back(nuistr.flagCC1pi0);
+  fbuf[cEnu].push_back(nuistr.Enu_true);
+  fbuf[cELep].push_back(nuistr.ELep);
+  fbuf[cCosLep].push_back(nuistr.CosLep);
+  fbuf[cQ2].push_back(nuistr.Q2);
+  fbuf[cQ0].push_back(nuistr.q0);
+  fbuf[cQ3].push_back(nuistr.q3);
+  fbuf[cY].push_back(nuistr.y);
+  fbuf[cWeight].push_back(nuistr.Weight);
+  fbuf[cInputWeight].push_back(nuistr.InputWeight);
+  fbuf[cRWWeight].push_back(nuistr.RWWeight);
+  fbuf[cCustomWeight].push_back(nuistr.CustomWeight);
+
+  for (int i=0; i<nuistr.nfsp; i++) {
+    fbuf[cFspPx].push_back(nuistr.fsp_px[i]);
+    fbuf[cFspPy].push_back(nuistr.fsp_py[i]);
+    fbuf[cFspPz].push_back(nuistr.fsp_pz[i]);
+    fbuf[cFspE].push_back(nuistr.fsp_E[i]);
+    ibuf[cFspPdg].push_back(nuistr.fsp_pdg[i]);
+  }
+  ibuf[cFspOffset].push_back(ibuf[cFspPdg].size());
+
+  for (int i=0; i<nuistr.ninitp; i++) {
+    fbuf[cInitPx].push_back(nuistr.initp_px[i]);
+    fbuf[cInitPy].push_back(nuistr.initp_py[i]);
+    fbuf[cInitPz].push_back(nuistr.initp_pz[i]);
+    fbuf[cInitE].push_back(nuistr.initp_E[i]);
+    ibuf[cInitPdg].push_back(nuistr.initp_pdg[i]);
+  }
+  ibuf[cInitOffset].push_back(ibuf[cInitPdg].size());
+
+  if (ibuf[cMode].size() >= groupsize) {
+    WriteGroup();
+  }
+}
+
+
+void EventStoreWriter::WriteBlock(size_t column) {
+  // Encode
+  const ColumnInfo& info = columns[column];
+  std::vector<char> raw;
+  float scale = 0;
+
+  if (IsInteger(info.encoding)) {
+    const std::vector<int32_t>& v = ibuf[column];
+    if (info.encoding == kInt8) {
+      raw.resize(v.size());
+      for (size_t i=0; i<v.size(); i++) raw[i] = (char)v[i];
+    }
+    else {
+      raw.resize(v.size() * sizeof(int32_t));
+      std::memcpy(raw.data(), v.data(), raw.size());
+    }
+  }
+  else {
+    const std::vector<float>& v = fbuf[column];
+    if (info.encoding == kFloat16) {
+      std::vector<uint16_t> h(v.size());
+      for (size_t i=0; i<v.size(); i++) h[i] = FloatToHalf(v[i]);
+      raw.resize(h.size() * sizeof(uint16_t));
+      std::memcpy(raw.data(), h.data(), raw.size());
+    }
+    else if (info.encoding == kQuant16) {
+      float vmax = 0;
+      for (float x : v) vmax = std::max(vmax, std::fabs(x));
+      scale = vmax > 0 ? vmax / 32767 : 1;
+      std::vector<int16_t> q(v.size());
+      for (size_t i=0; i<v.size(); i++) q[i] = (int16_t)std::lrint(v[i] / scale);
+      raw.resize(q.size() * sizeof(int16_t));
+      std::memcpy(raw.data(), q.data(), raw.size());
+    }
+    else {
+      raw.resize(v.size() * sizeof(float));
+      std::memcpy(raw.data(), v.data(), raw.size());
+    }
+  }
+
+  size_t pad = (kAlignment - (size_t)out.tellp() % kAlignment) % kAlignment;
+  out.write(std::string(pad, '\0').data(), pad);
+
+  BlockInfo block;
+  std::memset(&block, 0, sizeof(block));
+  block.offset = out.tellp();
+  block.scale = scale;
+
+  // Uncompressed blocks are written as they are, so they can be mapped
+  if (codec == kNone) {
+    out.write(raw.data(), raw.size());
+    block.size = raw.size();
+    blocks.push_back(block);
+    return;
+  }
+
+  // Compress in chunks, each with its own (stored size, raw size) header.
+  // Chunks that do not shrink are stored as they are.
+  std::vector<char> zipped(kMaxZipChunk + 512);
+  for (size_t pos=0; pos<raw.size(); pos+=kMaxZipChunk) {
+    int srcsize = std::min(kMaxZipChunk, raw.size() - pos);
+    int tgtsize = zipped.size();
+    int irep = 0;
+    Zip(&R__zipMultipleAlgorithm, level, codec, &srcsize, raw.data() + pos,
+        &tgtsize, zipped.data(), &irep);
+
+    uint32_t sizes[2] = { (uint32_t)srcsize, (uint32_t)srcsize };
+    const char* data = raw.data() + pos;
+    if (irep > 0 && irep < srcsize) {
+      sizes[0] = irep;
+      data = zipped.data();
+    }
+    out.write((const char*)sizes, sizeof(sizes));
+    out.write(data, sizes[0]);
+  }
+
+  block.size = (uint64_t)out.tellp() - block.offset;
+  blocks.push_back(block);
+}
+
+
+void EventStoreWriter::WriteGroup() {
+  GroupInfo group;
+  group.first = nentries;
+  group.nentries = ibuf[cMode].size();
+  group.nfsp = ibuf[cFspPdg].size();
+  group.ninitp = ibuf[cInitPdg].size();
+  if (group.nentries == 0) return;
+
+  for (size_t i=0; i<kNColumns; i++) {
+    WriteBlock(i);
+    fbuf[i].clear();
+    ibuf[i].clear();
+  }
+
+  ibuf[cFspOffset].push_back(0);
+  ibuf[cInitOffset].push_back(0);
+
+  groups.push_back(group);
+  nentries += group.nentries;
+}
+
+
+void EventStoreWriter::Close() {
+  WriteGroup();
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.ncolumns = columns.size();
+  header.ngroups = groups.size();
+  header.nentries = nentries;
+  header.directory = out.tellp();
+
+  out.write((const char*)columns.data(), columns.size() * sizeof(ColumnInfo));
+  out.write((const char*)groups.data(), groups.size() * sizeof(GroupInfo));
+  out.write((const char*)blocks.data(), blocks.size() * sizeof(BlockInfo));
+
+  out.seekp(0);
+  out.write((const char*)&header, sizeof(header));
+  out.close();
+
+  std::cout << "STORE " << nentries << " entries in " << groups.size()
+            << " row groups, " << header.directory << " bytes of data" << std::endl;
+}
+
+
+bool EventStore::IsEventStore(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  char magic[8] = {0};
+  in.read(magic, sizeof(magic));
+  return in && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+
+EventStore::EventStore(const std::string& filename)
+    : map(nullptr), mapsize(0) {
+  std::ifstream in(filename, std::ios::binary);
+  FileHeader header;
+  in.read((char*)&header, sizeof(header));
+  if (!in || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("EventStore: " + filename + " is not an event store");
+  }
+  if (header.version != kVersion) {
+    throw std::runtime_error("EventStore: unsupported version in " + filename);
+  }
+  nentries = header.nentries;
+
+  // Directory
+  std::vector<ColumnInfo> info(header.ncolumns);
+  std::vector<GroupInfo> groups(header.ngroups);
+  std::vector<BlockInfo> blocks(header.ngroups * header.ncolumns);
+  in.seekg(header.directory);
+  in.read((char*)info.data(), info.size() * sizeof(ColumnInfo));
+  in.read((char*)groups.data(), groups.size() * sizeof(GroupInfo));
+  in.read((char*)blocks.data(), blocks.size() * sizeof(BlockInfo));
+
+  // Match the stored columns to the schema by name. Integer columns must
+  // have the schema's width, since they are read as they are.
+  std::vector<int> index(info.size(), -1);
+  bool mappable = true;
+  for (size_t i=0; i<info.size(); i++) {
+    for (size_t j=0; j<kNColumns; j++) {
+      if (std::strncmp(info[i].name, kSchema[j].name, sizeof(info[i].name)) == 0) {
+        if (IsInteger(kSchema[j].encoding) && info[i].encoding != kSchema[j].encoding) {
+          throw std::runtime_error(std::string("EventStore: bad encoding for column ") + kSchema[j].name);
+        }
+        index[i] = j;
+      }
+    }
+    mappable = mappable && info[i].codec == kNone && info[i].encoding != kFloat16 && info[i].encoding != kQuant16;
+  }
+  for (size_t j=0; j<kNColumns; j++) {
+    if (std::find(index.begin(), index.end(), (int)j) == index.end()) {
+      throw std::runtime_error(std::string("EventStore: missing column ") + kSchema[j].name);
+    }
+  }
+
+  if (mappable) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0) {
+      mapsize = st.st_size;
+      map = mmap(nullptr, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+      if (map == MAP_FAILED) {
+        map = nullptr;
+      }
+      else {
+        madvise(map, mapsize, MADV_SEQUENTIAL);
+      }
+    }
+    if (fd >= 0) close(fd);
+  }
+
+  columns.resize(groups.size(), std::vector<const char*>(kNColumns, nullptr));
+
+  std::vector<char> stored;
+  for (size_t g=0; g<groups.size(); g++) {
+    groupfirst.push_back(groups[g].first);
+
+    for (size_t i=0; i<info.size(); i++) {
+      if (index[i] < 0) continue;
+      const BlockInfo& block = blocks[g * info.size() + i];
+
+      if (map) {
+        columns[g][index[i]] = (const char*)map + block.offset;
+        continue;
+      }
+
+      // Read and decompress
+      stored.resize(block.size);
+      in.seekg(block.offset);
+      in.read(stored.data(), stored.size());
+
+      std::vector<char> raw;
+      if (info[i].codec == kNone) {
+        raw.swap(stored);
+      }
+      for (size_t pos=0; pos<stored.size();) {
+        uint32_t sizes[2];
+        std::memcpy(sizes, stored.data() + pos, sizeof(sizes));
+        pos += sizeof(sizes);
+        size_t end = raw.size();
+        raw.resize(end + sizes[1]);
+        if (sizes[0] == sizes[1]) {
+          std::memcpy(raw.data() + end, stored.data() + pos, sizes[0]);
+        }
+        else {
+          int srcsize = sizes[0];
+          int tgtsize = sizes[1];
+          int irep = 0;
+          R__unzip(&srcsize, (unsigned char*)stored.data() + pos, &tgtsize,
+                   (unsigned char*)raw.data() + end, &irep);
+          if (irep != (int)sizes[1]) {
+            throw std::runtime_error("EventStore: corrupt block in " + filename);
+          }
+        }
+        pos += sizes[0];
+      }
+
+      // Expand reduced-precision momenta to float
+      if (info[i].encoding == kFloat16 || info[i].encoding == kQuant16) {
+        size_t n = raw.size() / sizeof(uint16_t);
+        std::vector<float> f(n);
+        if (info[i].encoding == kFloat16) {
+          const uint16_t* h = (const uint16_t*)raw.data();
+          for (size_t k=0; k<n; k++) f[k] = HalfToFloat(h[k]);
+        }
+        else {
+          const int16_t* q = (const int16_t*)raw.data();
+          for (size_t k=0; k<n; k++) f[k] = q[k] * block.scale;
+        }
+        raw.resize(n * sizeof(float));
+        std::memcpy(raw.data(), f.data(), raw.size());
+      }
+
+      decoded.push_back(std::move(raw));
+      columns[g][index[i]] = decoded.back().data();
+    }
+  }
+
+  std::cout << "STORE " << filename << ": " << nentries << " entries"
+            << (map ? ", memory-mapped" : "") << std::endl;
+}
+
+
+EventStore::~EventStore() {
+  if (map) {
+    munmap(map, mapsize);
+  }
+}
+
+
+void EventStore::GetEntry(long long i, NuisTree& nuistr) const {
+  size_t g = std::upper_bound(groupfirst.begin(), groupfirst.end(), i) - groupfirst.begin() - 1;
+  const std::vector<const char*>& column = columns[g];
+  long long k = i - groupfirst[g];
+
+  auto I = [&](int c) { return ((const int32_t*)column[c])[k]; };
+  auto B = [&](int c) { return ((const int8_t*)column[c])[k]; };
+  auto F = [&](int c) { return ((const float*)column[c])[k]; };
+
+  nuistr.Mode = I(cMode);
+  nuistr.PDGnu = I(cPDGnu);
+  nuistr.iscc = B(cCC);
+  nuistr.tgt = I(cTgt);
+  nuistr.PDGLep = I(cPDGLep);
+  nuistr.flagCC1pip = B(cFlagCC1pip);
+  nuistr.flagCC1pim = B(cFlagCC1pim);
+  nuistr.flagCC1pi0 = B(cFlagCC1pi0);
+  nuistr.Enu_true = F(cEnu);
+  nuistr.ELep = F(cELep);
+  nuistr.CosLep = F(cCosLep);
+  nuistr.Q2 = F(cQ2);
+  nuistr.q0 = F(cQ0);
+  nuistr.q3 = F(cQ3);
+  nuistr.y = F(cY);
+  nuistr.Weight = F(cWeight);
+  nuistr.InputWeight = F(cInputWeight);
+  nuistr.RWWeight = F(cRWWeight);
+  nuistr.CustomWeight = F(cCustomWeight);
+
+  // Particle stacks are not copied: point straight at the columns
+  const int32_t* offset = (const int32_t*)column[cFspOffset];
+  nuistr.nfsp = offset[k+1] - offset[k];
+  nuistr.fsp_px = (const float*)column[cFspPx] + offset[k];
+  nuistr.fsp_py = (const float*)column[cFspPy] + offset[k];
+  nuistr.fsp_pz = (const float*)column[cFspPz] + offset[k];
+  nuistr.fsp_E = (const float*)column[cFspE] + offset[k];
+  nuistr.fsp_pdg = (const int32_t*)column[cFspPdg] + offset[k];
+
+  offset = (const int32_t*)column[cInitOffset];
+  nuistr.ninitp = offset[k+1] - offset[k];
+  nuistr.initp_px = (const float*)column[cInitPx] + offset[k];
+  nuistr.initp_py = (const float*)column[cInitPy] + offset[k];
+  nuistr.initp_pz = (const float*)column[cInitPz] + offset[k];
+  nuistr.initp_E = (const float*)column[cInitE] + offset[k];
+  nuistr.initp_pdg = (const int32_t*)column[cInitPdg] + offset[k];
+
+  nuistr.ComputeDerived();
+}
@@ -0,0 +1,181 @@
+#ifndef __EVENTSTORE__
+#define __EVENTSTORE__
+
+/**
+ * Compact columnar cache of the NUISANCE tree fields used for plotting.
+ *
+ * Converting a GenericVectors__VARS tree once with make_eventstore lets
+ * repeated plotting passes (e.g. after a binning or cut change) skip ROOT
+ * decompression of all ~70 branches. Only the fields read by the filters
+ * and distributions are kept.
+ *
+ * File layout: a fixed header, then row groups of column blocks, then a
+ * directory. Each column is stored column-wise within a row group; the
+ * final-state and initial-state particle stacks are flattened, with a
+ * per-group offset table giving each entry's range in them. Blocks may be
+ * compressed with ROOT's codecs (zlib, LZ4, zstd), and the particle
+ * momenta may optionally be stored as float16 or quantized 16-bit values.
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class NuisTree;
+
+namespace eventstore {
+
+  /** Which particle stack a column belongs to. */
+  enum Stack {
+    kEvent = 0,  //!< One value per entry
+    kFSP = 1,  //!< One value per final-state particle
+    kInit = 2,  //!< One value per initial-state particle
+    kOffsets = 3  //!< Stack offsets, one per entry plus one
+  };
+
+  /** On-disk encoding of a column. */
+  enum Encoding {
+    kInt32 = 0,
+    kFloat32 = 1,
+    kInt8 = 2,
+    kFloat16 = 3,  //!< IEEE half precision
+    kQuant16 = 4  //!< 16-bit integer times a per-block scale
+  };
+
+  /** Block codec. Values follow ROOT::RCompressionSetting::EAlgorithm. */
+  enum Codec {
+    kNone = 0,
+    kZLIB = 1,
+    kLZ4 = 4,
+    kZSTD = 5
+  };
+
+  /** Parse a codec name (none, zlib, lz4, zstd). Returns -1 if unknown. */
+  int ParseCodec(const std::string& name);
+
+  /** Parse a momentum encoding name (float32, float16, quant16). Returns -1 if unknown. */
+  int ParseEncoding(const std::string& name);
+
+  /** File header. */
+  struct FileHeader {
+    char magic[8];  //!< "NUISEVS" plus a terminating zero
+    uint32_t version;  //!< Format version
+    uint32_t ncolumns;  //!< Number of columns
+    uint64_t ngroups;  //!< Number of row groups
+    uint64_t nentries;  //!< Total number of entries
+    uint64_t directory;  //!< Byte offset of the directory
+  };
+
+  /** Column description, as stored in the directory. */
+  struct ColumnInfo {
+    char name[24];
+    uint8_t stack;  //!< Stack
+    uint8_t encoding;  //!< Encoding
+    uint8_t codec;  //!< Codec
+    uint8_t pad[5];
+  };
+
+  /** Row group description, as stored in the directory. */
+  struct GroupInfo {
+    uint64_t first;  //!< First entry in the group
+    uint64_t nentries;  //!< Number of entries
+    uint64_t nfsp;  //!< Total number of final-state particles
+    uint64_t ninitp;  //!< Total number of initial-state particles
+  };
+
+  /** Location of one column block, as stored in the directory. */
+  struct BlockInfo {
+    uint64_t offset;  //!< Byte offset in the file
+    uint64_t size;  //!< Stored (possibly compressed) size in bytes
+    float scale;  //!< Quantization step, for kQuant16
+    uint32_t pad;
+  };
+
+}  // namespace eventstore
+
+
+/**
+ * \class EventStoreWriter
+ * \brief Converts NUISANCE events to an event store file.
+ *
+ * Events are buffered one row group at a time, so memory use does not grow
+ * with the size of the input.
+ *
+ * \param _filename Output file name
+ * \param _codec Block codec (eventstore::Codec)
+ * \param _level Compression level
+ * \param _momentum Encoding for particle px/py/pz (eventstore::Encoding)
+ * \param _groupsize Number of entries per row group
+ */
+class EventStoreWriter {
+public:
+  EventStoreWriter(std::string _filename, int _codec=eventstore::kLZ4,
+                   int _level=4, int _momentum=eventstore::kFloat32,
+                   size_t _groupsize=1000000);
+
+  /** Add an event. */
+  void Fill(const NuisTree& nuistr);
+
+  /** Write the last row group and the directory. */
+  void Close();
+
+private:
+  void WriteGroup();
+  void WriteBlock(size_t column);
+
+  std::ofstream out;
+  int codec;  //!< Block codec
+  int level;  //!< Compression level
+  size_t groupsize;  //!< Entries per row group
+  uint64_t nentries;  //!< Entries written so far
+  std::vector<eventstore::ColumnInfo> columns;
+  std::vector<eventstore::GroupInfo> groups;
+  std::vector<eventstore::BlockInfo> blocks;
+  std::vector<std::vector<float> > fbuf;  //!< Buffered float columns
+  std::vector<std::vector<int32_t> > ibuf;  //!< Buffered integer columns
+};
+
+
+/**
+ * \class EventStore
+ * \brief Reads an event store file.
+ *
+ * Stores written without compression or reduced-precision momenta (the
+ * "-c none" option of make_eventstore) are memory-mapped: entries are read
+ * straight from the mapped pages with no decoding, and the OS page cache is
+ * shared between all jobs reading the same file on a node. Other stores are
+ * decoded into memory when opened. Either way NuisTree's particle stacks are
+ * pointed at the columns rather than copied, and the store is read-only
+ * afterwards, so a single instance can serve any number of threads.
+ *
+ * \param filename Input file name
+ */
+class EventStore {
+public:
+  EventStore(const std::string& filename);
+  ~EventStore();
+  EventStore(const EventStore&) = delete;
+
+  /** Check for the event store magic at the start of a file. */
+  static bool IsEventStore(const std::string& filename);
+
+  /** Number of entries in the store. */
+  long long GetEntries() const { return nentries; }
+
+  /** Point a NuisTree at entry i. */
+  void GetEntry(long long i, NuisTree& nuistr) const;
+
+  /** True if the file is memory-mapped rather than decoded. */
+  bool IsMapped() const { return map != nullptr; }
+
+private:
+  long long nentries;
+  std::vector<long long> groupfirst;  //!< First entry of each row group
+  std::vector<std::vector<const char*> > columns;  //!< Column data, per row group
+  std::vector<std::vector<char> > decoded;  //!< Decoded blocks, if not mapped
+  void* map;  //!< Mapped file, if any
+  size_t mapsize;  //!< Size of the mapping
+};
+
+#endif  // __EVENTSTORE__
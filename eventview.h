@@ -0,0 +1,239 @@
+#ifndef __EVENTVIEW__
+#define __EVENTVIEW__
+
+/**
+ * Generator-independent views of one event.
+ *
+ * The distributions are filled both from gallery (simb::MCTruth) and from
+ * NUISANCE trees. Rather than implementing each variable twice, the
+ * kinematic kernels in distributions.cpp are templates on an event view,
+ * and each input gets a lightweight adapter. A view V provides:
+ *
+ *   Particle V::Nu() const;              // incoming neutrino
+ *   Particle V::Lepton() const;          // outgoing lepton
+ *   Particle V::Nucleon() const;         // struck nucleon
+ *   ParticleSpan V::FinalState() const;  // stable final state particles, with
+ *                                        // their derived columns
+ *   float V::Enu(), V::Q2(), V::q0(), V::q3(), V::y(), V::CosLep() const;
+ *
+ * Kernels are instantiated for each view at compile time, so there are no
+ * virtual calls in the fills.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "NuisTree.h"
+#include "fourvector.h"
+#include "particlecolumns.h"
+#ifdef __LARSOFT__
+#include "nusimdata/SimulationBase/MCTruth.h"
+#include "nusimdata/SimulationBase/MCNeutrino.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+#include "GENIE/Framework/GHEP/GHepStatus.h"
+#endif
+
+/** One particle: PDG code and four-momentum (GeV). */
+struct Particle {
+  int pdg;
+  float E;
+  float px;
+  float py;
+  float pz;
+
+  /** Momentum magnitude. */
+  float P() const { return std::sqrt(px * px + py * py + pz * pz); }
+
+  /** Four-momentum, in double precision for invariants. */
+  FourVectorD P4() const { return FourVectorD{px, py, pz, E}; }
+
+  /** Three-momentum. */
+  Vector3F P3() const { return Vector3F{px, py, pz}; }
+};
+
+
+/**
+ * \class ParticleSpan
+ * \brief A list of particles, as parallel arrays (not owned).
+ *
+ * Besides the four-momenta, the span carries the derived columns computed
+ * once per event (particlecolumns.h), which the kernels read rather than
+ * recomputing.
+ */
+struct ParticleSpan {
+  int n;  //!< Number of particles
+  const int* pdg;  //!< PDG codes
+  const float* E;  //!< Energies
+  const float* px;  //!< Momentum x
+  const float* py;  //!< Momentum y
+  const float* pz;  //!< Momentum z
+  const float* p;  //!< Momentum magnitudes
+  const float* ke;  //!< Kinetic energies
+  const float* costheta;  //!< cos(theta) with respect to z
+  const float* phi;  //!< Azimuthal angles
+
+  /** Particle i. */
+  Particle operator[](int i) const { return Particle{pdg[i], E[i], px[i], py[i], pz[i]}; }
+};
+
+
+/**
+ * \class NuisView
+ * \brief Event view of a NUISANCE tree entry.
+ *
+ * The final state is the tree's fsp stack, without copying. The neutrino
+ * and struck nucleon are looked up in the initial state stack, and the
+ * lepton in the final state stack (by PDGLep and ELep); each must be
+ * unique.
+ */
+class NuisView {
+public:
+  NuisView(const NuisTree& _nuistr) : nuistr(_nuistr) {}
+
+  Particle Nu() const { return Initial(Find(nuistr.initp_pdg, nuistr.ninitp, nuistr.PDGnu)); }
+
+  Particle Lepton() const {
+    int i_lep = -999;
+    for (int i=0; i<nuistr.nfsp; i++) {
+      if (nuistr.fsp_pdg[i] == nuistr.PDGLep && nuistr.fsp_E[i] == nuistr.ELep) {
+        // check this is the only lepton we've found
+        assert(i_lep == -999);
+        i_lep = i;
+      }
+    }
+    assert(i_lep != -999);
+    return FinalState()[i_lep];
+  }
+
+  Particle Nucleon() const {
+    int i_nuc = -999;
+    for (int i=0; i<nuistr.ninitp; i++) {
+      if (nuistr.initp_pdg[i] == 2212 || nuistr.initp_pdg[i] == 2112) {
+        // check this is the only initial nucleon we've found
+        assert(i_nuc == -999);
+        i_nuc = i;
+      }
+    }
+    assert(i_nuc != -999);
+    return Initial(i_nuc);
+  }
+
+  ParticleSpan FinalState() const {
+    return ParticleSpan{nuistr.nfsp, nuistr.fsp_pdg, nuistr.fsp_E,
+                        nuistr.fsp_px, nuistr.fsp_py, nuistr.fsp_pz,
+                        nuistr.fsp_p, nuistr.fsp_ke, nuistr.fsp_costheta, nuistr.fsp_phi};
+  }
+
+  float Enu() const { return nuistr.Enu_true; }
+  float Q2() const { return nuistr.Q2; }
+  float q0() const { return nuistr.q0; }
+  float q3() const { return nuistr.q3; }
+  float y() const { return nuistr.y; }
+  float CosLep() const { return nuistr.CosLep; }
+
+private:
+  Particle Initial(int i) const {
+    return Particle{nuistr.initp_pdg[i], nuistr.initp_E[i],
+                    nuistr.initp_px[i], nuistr.initp_py[i], nuistr.initp_pz[i]};
+  }
+
+  static int Find(const int* pdg, int n, int code) {
+    int found = -999;
+    for (int i=0; i<n; i++) {
+      if (pdg[i] == code) {
+        assert(found == -999);
+        found = i;
+      }
+    }
+    assert(found != -999);
+    return found;
+  }
+
+  const NuisTree& nuistr;
+};
+
+
+#ifdef __LARSOFT__
+/**
+ * \class TruthView
+ * \brief Event view of a simb::MCTruth (GENIE).
+ *
+ * The stable final state particles are gathered once, with their derived
+ * columns, into per-thread buffers reused from event to event; only one
+ * TruthView per thread may be in use at a time. The plotter makes one per
+ * MCTruth and passes it to every distribution. The struck nucleon is
+ * particle 2 if its status is 11, otherwise (a free nucleon) particle 1.
+ */
+class TruthView {
+public:
+  TruthView(const simb::MCTruth& _truth) : truth(_truth), nu(_truth.GetNeutrino()) {
+    Buffers& b = buffers();
+    b.pdg.clear(); b.E.clear(); b.px.clear(); b.py.clear(); b.pz.clear();
+    for (int i=0; i<truth.NParticles(); i++) {
+      const simb::MCParticle& p = truth.GetParticle(i);
+      if (p.StatusCode() != genie::kIStStableFinalState) {
+        continue;
+      }
+      b.pdg.push_back(p.PdgCode());
+      b.E.push_back(p.E());
+      b.px.push_back(p.Px());
+      b.py.push_back(p.Py());
+      b.pz.push_back(p.Pz());
+    }
+
+    size_t n = b.pdg.size();
+    b.p.resize(n); b.ke.resize(n); b.costheta.resize(n); b.phi.resize(n);
+    DeriveParticleColumns(n, b.pdg.data(), b.E.data(), b.px.data(), b.py.data(), b.pz.data(),
+                          b.p.data(), b.ke.data(), b.costheta.data(), b.phi.data());
+  }
+
+  /** The underlying record, for fills that need more than the views give. */
+  const simb::MCTruth& Truth() const { return truth; }
+
+  Particle Nu() const { return Convert(nu.Nu()); }
+  Particle Lepton() const { return Convert(nu.Lepton()); }
+
+  Particle Nucleon() const {
+    int i_nuc = (truth.GetParticle(2).StatusCode() == 11) ? 2 : 1;
+    int nuc_pdg = truth.GetParticle(i_nuc).PdgCode();
+    assert(nuc_pdg==2212 || nuc_pdg==2112 || nuc_pdg==1000010010 || nuc_pdg==1000000010);
+    return Convert(truth.GetParticle(i_nuc));
+  }
+
+  ParticleSpan FinalState() const {
+    const Buffers& b = buffers();
+    return ParticleSpan{(int)b.pdg.size(), b.pdg.data(), b.E.data(),
+                        b.px.data(), b.py.data(), b.pz.data(),
+                        b.p.data(), b.ke.data(), b.costheta.data(), b.phi.data()};
+  }
+
+  float Enu() const { return nu.Nu().E(); }
+  float Q2() const { return nu.QSqr(); }
+  float q0() const { return nu.Nu().E() - nu.Lepton().E(); }
+  float q3() const { return (Nu().P3() - Lepton().P3()).Mag(); }
+  float y() const { return nu.Y(); }
+  float CosLep() const { return Lepton().P3().CosTheta(); }
+
+private:
+  struct Buffers {
+    std::vector<int> pdg;
+    std::vector<float> E, px, py, pz;
+    std::vector<float> p, ke, costheta, phi;  // derived
+  };
+
+  static Buffers& buffers() {
+    static thread_local Buffers b;
+    return b;
+  }
+
+  static Particle Convert(const simb::MCParticle& p) {
+    return Particle{p.PdgCode(), (float)p.E(), (float)p.Px(), (float)p.Py(), (float)p.Pz()};
+  }
+
+  const simb::MCTruth& truth;
+  const simb::MCNeutrino& nu;
+};
+#endif
+
+#endif  // __EVENTVIEW__
@@ -5,6 +5,7 @@
 #include "nusimdata/SimulationBase/MCNeutrino.h"
 #endif
 #include "filter.h"
+#include "zonemap.h"
 
 std::string Filter::GetNuType(int pdg) {
   std::string nu;
@@ -48,6 +49,10 @@ namespace filters {
     title = nu + (cc == enums::kCC ? "CC" : "NC") + inttype;
   }
 
+  std::string NuMode::Key() const {
+    return "NuMode_" + std::to_string(pdg) + "_" + std::to_string(cc) + "_" + std::to_string(mode);
+  }
+
   #ifdef __LARSOFT__
   bool NuMode::operator()(const simb::MCTruth& truth) {
     const simb::MCNeutrino& nu = truth.GetNeutrino();
@@ -60,6 +65,21 @@ namespace filters {
             nu.Mode() == mode);
   }
   #else
+  bool NuMode::CanPass(const Zone& zone) const {
+    if (!zone.HasPDGnu(pdg) || !zone.HasCC(cc == enums::kCC)) {
+      return false;
+    }
+    if (mode == enums::kUndefined || zone.nmodes < 0) {
+      return true;
+    }
+    for (int i=0; i<zone.nmodes; i++) {
+      if (NuisTree::GetGENIEMode(zone.modes[i]) == mode) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool NuMode::operator()(const NuisTree& nuistr) {
     int _cc_tmp = nuistr.GetCCNCEnum();
     int _mode_tmp = nuistr.GetGENIEMode();
@@ -79,6 +99,10 @@ namespace filters {
     title = nu + "CC1#pi" + (charged ? "^{#pm}" : "");
   }
 
+  std::string CC1Pi::Key() const {
+    return "CC1Pi_" + std::to_string(pdg) + "_" + std::to_string(charged);
+  }
+
   #ifdef __LARSOFT__
   bool CC1Pi::operator()(const simb::MCTruth& truth) {
     const simb::MCNeutrino& nu = truth.GetNeutrino();
@@ -109,6 +133,10 @@ namespace filters {
     return (npi == 1);
   }
   #else
+  bool CC1Pi::CanPass(const Zone& zone) const {
+    return zone.HasPDGnu(pdg);
+  }
+
   bool CC1Pi::operator()(const NuisTree& nuistr) {
     if (nuistr.PDGnu != pdg) return false;
 
@@ -14,6 +14,8 @@
 #include "nusimdata/SimulationBase/MCTruth.h"
 #endif
 
+struct Zone;
+
 /**
  * \class Filter
  * \brief Base class for event filters.
@@ -33,6 +35,12 @@ public:
   /** Convert neutrino interaction mode to a string. */
   static std::string GetNuMode(const int mode);
 
+  /**
+   * A string identifying the selection, used to key results cached between
+   * runs (e.g. entry lists). Filters returning "" are never cached.
+   */
+  virtual std::string Key() const { return ""; }
+
   std::string title;  //!< ROOT/LaTeX title
 };
 #else
@@ -47,6 +55,18 @@ public:
   /** Convert neutrino interaction mode to a string. */
   static std::string GetNuMode(const int mode);
 
+  /**
+   * A string identifying the selection, used to key results cached between
+   * runs (e.g. entry lists). Filters returning "" are never cached.
+   */
+  virtual std::string Key() const { return ""; }
+
+  /**
+   * Could any event in the zone pass? Filters return false only when the
+   * zone summary proves no event can, so that the zone is skipped.
+   */
+  virtual bool CanPass(const Zone&) const { return true; }
+
   std::string title;  //!< ROOT/LaTeX title
 };
 #endif
@@ -68,7 +88,9 @@ namespace filters {
     virtual bool operator()(const simb::MCTruth& truth);
     #else
     virtual bool operator()(const NuisTree& nuistr);
+    virtual bool CanPass(const Zone& zone) const;
     #endif
+    virtual std::string Key() const;
 
     int pdg;  //!< Neutrino PDG code
     int mode;  //!< Interaction mode
@@ -90,7 +112,9 @@ namespace filters {
     virtual bool operator()(const simb::MCTruth& truth);
     #else
     virtual bool operator()(const NuisTree& nuistr);
+    virtual bool CanPass(const Zone& zone) const;
     #endif
+    virtual std::string Key() const;
 
     int pdg;  //!< Neutrino PDG code
     bool charged;  //!< Require one charged pion, no neutrals
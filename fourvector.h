@@ -0,0 +1,91 @@
+#ifndef __FOURVECTOR__
+#define __FOURVECTOR__
+
+/**
+ * Lightweight three- and four-vectors for the kinematic kernels.
+ *
+ * TVector3 and TLorentzVector derive from TObject, so every temporary
+ * carries a vtable and TObject bookkeeping, and their angle functions go
+ * through general trigonometry (e.g. cos(Angle()) is a acos followed by a
+ * cos). These are plain aggregates with constexpr arithmetic, templated on
+ * the precision, and the angle functions use direct formulas: cos(theta) =
+ * pz/|p|, the cosine of the opening angle from the dot product, and delta
+ * phi from a single atan2.
+ *
+ * The results match the ROOT classes up to rounding (and, for null
+ * vectors, follow their conventions in CosTheta and CosAngle);
+ * bench_kinematics compares the two.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \class Vector3
+ * \brief A three-vector.
+ */
+template <class T>
+struct Vector3 {
+  T x;
+  T y;
+  T z;
+
+  constexpr Vector3 operator+(const Vector3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+  constexpr Vector3 operator-(const Vector3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+  constexpr Vector3 operator*(T a) const { return {a * x, a * y, a * z}; }
+  constexpr T Dot(const Vector3& o) const { return x * o.x + y * o.y + z * o.z; }
+  constexpr T Mag2() const { return Dot(*this); }
+  T Mag() const { return std::sqrt(Mag2()); }
+
+  /** cos(theta) with respect to z; 1 for a null vector, as TVector3::CosTheta. */
+  T CosTheta() const {
+    T p = Mag();
+    return p == 0 ? T(1) : z / p;
+  }
+
+  /** Cosine of the angle to another vector; 1 if either is null, as TVector3::Angle. */
+  T CosAngle(const Vector3& o) const {
+    T norm2 = Mag2() * o.Mag2();
+    if (norm2 <= 0) return T(1);
+    return std::max(T(-1), std::min(T(1), Dot(o) / std::sqrt(norm2)));
+  }
+
+  /** phi - o.phi, in [-pi, pi], as TVector3::DeltaPhi. */
+  T DeltaPhi(const Vector3& o) const {
+    return std::atan2(y * o.x - x * o.y, x * o.x + y * o.y);
+  }
+};
+
+
+/**
+ * \class FourVector
+ * \brief A four-vector (px, py, pz, E), with metric (+,-,-,-).
+ */
+template <class T>
+struct FourVector {
+  T px;
+  T py;
+  T pz;
+  T E;
+
+  constexpr FourVector operator+(const FourVector& o) const { return {px + o.px, py + o.py, pz + o.pz, E + o.E}; }
+  constexpr FourVector operator-(const FourVector& o) const { return {px - o.px, py - o.py, pz - o.pz, E - o.E}; }
+  constexpr T Dot(const FourVector& o) const { return E * o.E - px * o.px - py * o.py - pz * o.pz; }
+  constexpr T Mag2() const { return Dot(*this); }
+  constexpr Vector3<T> Vect() const { return {px, py, pz}; }
+
+  /** Invariant mass, negative for spacelike vectors, as TLorentzVector::Mag. */
+  T Mag() const {
+    T mm = Mag2();
+    return mm < 0 ? -std::sqrt(-mm) : std::sqrt(mm);
+  }
+
+  T M() const { return Mag(); }
+};
+
+typedef Vector3<float> Vector3F;
+typedef Vector3<double> Vector3D;
+typedef FourVector<float> FourVectorF;
+typedef FourVector<double> FourVectorD;
+
+#endif  // __FOURVECTOR__
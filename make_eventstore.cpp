@@ -0,0 +1,83 @@
+/**
+ * Convert NUISANCE GenericVectors__VARS trees to an event store.
+ *
+ * The event store keeps only the fields used by the plotters, column-wise
+ * and optionally compressed, so that repeated runs of plot_kinematics_nuistr
+ * on the same sample are much faster than reading the original tree.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TTree.h"
+#include "NuisTree.h"
+#include "eventstore.h"
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  int codec = eventstore::kLZ4;
+  int level = 4;
+  int momentum = eventstore::kFloat32;
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-c" && i+1 < argc) {
+      codec = eventstore::ParseCodec(argv[++i]);
+    }
+    else if (arg == "-l" && i+1 < argc) {
+      level = std::atoi(argv[++i]);
+    }
+    else if (arg == "-m" && i+1 < argc) {
+      momentum = eventstore::ParseEncoding(argv[++i]);
+    }
+    else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() < 2 || codec < 0 || momentum < 0) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "[-c none|zlib|lz4|zstd] [-l LEVEL] [-m float32|float16|quant16] "
+              << "OUTPUT.evs INPUT.root [INPUT2.root ...]" << std::endl
+              << "  -c  Block codec (default lz4; zstd needs ROOT >= 6.20)" << std::endl
+              << "  -l  Compression level (default 4)" << std::endl
+              << "  -m  Encoding for particle momenta (default float32)" << std::endl;
+    return 0;
+  }
+
+  EventStoreWriter writer(args[0], codec, level, momentum);
+
+  for (size_t i=1; i<args.size(); i++) {
+    std::cout << "FILE " << args[i] << std::endl;
+    TFile fin(args[i].c_str(), "READ");
+    TTree *intree = (TTree*)fin.Get("GenericVectors__VARS");
+    if (!intree) {
+      std::cout << "Error: no GenericVectors__VARS tree in " << args[i] << std::endl;
+      return 1;
+    }
+
+    NuisTree nuistr(intree);
+    nuistr.DisableBranch("nvertp");
+    nuistr.DisableBranch("*_vert");
+    nuistr.DisableBranch("CustomWeightArray");
+    nuistr.SetupCache();
+
+    for (const auto& cluster : nuistr.GetClusters()) {
+      for (Long64_t ievent=cluster.first; ievent<cluster.second; ievent++) {
+        if (ievent % 100000 == 0) {
+          std::cout << "EVENT " << ievent << std::endl;
+        }
+        nuistr.GetEntry(ievent);
+        writer.Fill(nuistr);
+      }
+    }
+
+    nuistr.PrintCacheStats();
+  }
+
+  writer.Close();
+
+  return 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * Export the plot set's variables as an unbinned ntuple.
+ *
+ * Each event passing at least one of the plot set's filters is written as
+ * one row of an "ntuple" tree: a bit mask of the filters it passes, the
+ * event weight, Enu_true, tgt, Mode and PDGnu, and one float column per
+ * variable the plot set makes (q2, thw, expw, plep, tlep, pp, tp, multp,
+ * ...). Columns are named after the distributions without their selection
+ * prefix, e.g. "num_ccqe_q2" and "num_nc_q2" both fill "q2", and 2D
+ * variables take two columns ("q0q3_x", "q0q3_y").
+ *
+ * A variable is computed only for events passing a filter that it is
+ * plotted with, so that it is well defined for the event (e.g. the
+ * theorists' W needs a single hit nucleon); otherwise it is NaN. The filter
+ * keys, in bit order, are stored in a "filters" TNamed.
+ *
+ * Histograms with any binning are then made from the ntuple with
+ * rebin_ntuple, without rereading the generator output.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TH1.h"
+#include "TNamed.h"
+#include "TTree.h"
+#include "NuisTree.h"
+#include "distributions.h"
+#include "eventstore.h"
+#include "filter.h"
+#include "plotset.h"
+
+namespace {
+
+  // Column name of a distribution: its name without the selection prefix
+  // (e.g. "num_ccqe_q2" -> "q2")
+  std::string Variable(const std::string& name) {
+    size_t first = name.find('_');
+    size_t second = (first == std::string::npos) ? first : name.find('_', first + 1);
+    return (second == std::string::npos) ? name : name.substr(second + 1);
+  }
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  if (argc < 3) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "OUTPUT.root INPUT.root|INPUT.evs [INPUT2 ...]" << std::endl;
+    return 0;
+  }
+
+  TH1::AddDirectory(false);
+
+  std::vector<Distribution*> dists = MakeDistributions();
+
+  // Distinct filters, one mask bit each
+  std::vector<Filter*> filters;
+  std::vector<size_t> distfilter;
+  for (Distribution* dist : dists) {
+    auto it = std::find(filters.begin(), filters.end(), dist->filter);
+    if (it == filters.end()) {
+      it = filters.insert(it, dist->filter);
+    }
+    distfilter.push_back(it - filters.begin());
+  }
+  if (filters.size() > 64) {
+    std::cout << "Error: more than 64 filters" << std::endl;
+    return 1;
+  }
+
+  // Columns, shared by the distributions of the same variable, and the
+  // columns each distribution records into
+  std::vector<std::string> columns;
+  std::vector<std::vector<size_t> > distcolumns(dists.size());
+  std::map<std::string, size_t> column;
+  auto add = [&](const std::string& name) {
+    auto it = column.find(name);
+    if (it == column.end()) {
+      it = column.insert(std::make_pair(name, columns.size())).first;
+      columns.push_back(name);
+    }
+    return it->second;
+  };
+
+  for (size_t j=0; j<dists.size(); j++) {
+    std::vector<Distribution*> parts = { dists[j] };
+    distributions::MultGroup* group = dynamic_cast<distributions::MultGroup*>(dists[j]);
+    if (group) {
+      parts.assign(group->mults.begin(), group->mults.end());
+    }
+    for (Distribution* part : parts) {
+      std::string var = Variable(part->name);
+      if (part->hist->GetDimension() == 2) {
+        distcolumns[j].push_back(add(var + "_x"));
+        add(var + "_y");
+      }
+      else {
+        distcolumns[j].push_back(add(var));
+      }
+    }
+  }
+
+  std::vector<float> values(columns.size());
+  std::vector<char> done(columns.size());
+  for (size_t j=0; j<dists.size(); j++) {
+    distributions::MultGroup* group = dynamic_cast<distributions::MultGroup*>(dists[j]);
+    for (size_t k=0; k<distcolumns[j].size(); k++) {
+      Distribution* part = group ? group->mults[k] : dists[j];
+      part->SetCapture(&values[distcolumns[j][k]]);
+    }
+  }
+
+  // Output tree
+  TFile fout(argv[1], "RECREATE");
+  TTree* ntuple = new TTree("ntuple", "Plot set variables");
+  ULong64_t mask;
+  float weight, enu;
+  int tgt, mode, pdgnu;
+  ntuple->Branch("filters", &mask, "filters/l");
+  ntuple->Branch("Weight", &weight, "Weight/F");
+  ntuple->Branch("Enu_true", &enu, "Enu_true/F");
+  ntuple->Branch("tgt", &tgt, "tgt/I");
+  ntuple->Branch("Mode", &mode, "Mode/I");
+  ntuple->Branch("PDGnu", &pdgnu, "PDGnu/I");
+  for (size_t c=0; c<columns.size(); c++) {
+    ntuple->Branch(columns[c].c_str(), &values[c], (columns[c] + "/F").c_str());
+  }
+
+  std::string keys;
+  for (size_t k=0; k<filters.size(); k++) {
+    std::string key = filters[k]->Key();
+    keys += (k > 0 ? "," : "") + (key.empty() ? filters[k]->title : key);
+  }
+
+  // Event loop
+  Long64_t nwritten = 0;
+  for (int i=2; i<argc; i++) {
+    std::string filename = argv[i];
+    std::cout << "FILE " << filename << std::endl;
+
+    std::unique_ptr<EventStore> store;
+    std::unique_ptr<TFile> fin;
+    std::unique_ptr<NuisTree> nuistr;
+    std::vector<std::pair<Long64_t, Long64_t> > clusters;
+    if (EventStore::IsEventStore(filename)) {
+      store.reset(new EventStore(filename));
+      nuistr.reset(new NuisTree());
+      clusters.push_back(std::make_pair(0LL, store->GetEntries()));
+    }
+    else {
+      fin.reset(new TFile(filename.c_str(), "READ"));
+      TTree* intree = (TTree*)fin->Get("GenericVectors__VARS");
+      if (!intree) {
+        std::cout << "Error: no GenericVectors__VARS tree in " << filename << std::endl;
+        return 1;
+      }
+      nuistr.reset(new NuisTree(intree));
+      nuistr->DisableBranch("nvertp");
+      nuistr->DisableBranch("*_vert");
+      nuistr->DisableBranch("CustomWeightArray");
+      nuistr->SetupCache();
+      clusters = nuistr->GetClusters();
+    }
+
+    for (const auto& cluster : clusters) {
+      for (Long64_t ievent=cluster.first; ievent<cluster.second; ievent++) {
+        if (ievent % 100000 == 0) {
+          std::cout << "EVENT " << ievent << std::endl;
+        }
+        if (store) {
+          store->GetEntry(ievent, *nuistr);
+        }
+        else {
+          nuistr->GetEntry(ievent);
+        }
+
+        mask = 0;
+        for (size_t k=0; k<filters.size(); k++) {
+          if ((*filters[k])(*nuistr)) {
+            mask |= (1ULL << k);
+          }
+        }
+        if (mask == 0) {
+          continue;
+        }
+
+        // Each variable is computed once, by the first passing distribution
+        std::fill(values.begin(), values.end(), std::numeric_limits<float>::quiet_NaN());
+        std::fill(done.begin(), done.end(), 0);
+        for (size_t j=0; j<dists.size(); j++) {
+          if (!(mask & (1ULL << distfilter[j])) || done[distcolumns[j][0]]) {
+            continue;
+          }
+          dists[j]->Fill(*nuistr);
+          for (size_t c : distcolumns[j]) {
+            done[c] = 1;
+          }
+        }
+
+        weight = nuistr->Weight;
+        enu = nuistr->Enu_true;
+        tgt = nuistr->tgt;
+        mode = nuistr->Mode;
+        pdgnu = nuistr->PDGnu;
+        ntuple->Fill();
+        nwritten++;
+      }
+    }
+
+    if (!store) {
+      nuistr->PrintCacheStats();
+    }
+  }
+
+  fout.cd();
+  ntuple->Write();
+  TNamed("filters", keys.c_str()).Write();
+  fout.Close();
+
+  std::cout << "WRITE " << argv[1] << ": " << nwritten << " events, "
+            << columns.size() << " variables" << std::endl;
+
+  return 0;
+}
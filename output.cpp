@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "RVersion.h"
+#include "ROOT/TBufferMerger.hxx"
+#include "ROOT/TProcessExecutor.hxx"
+#include "ROOT/TSeq.hxx"
+#include "TCanvas.h"
+#include "TDirectory.h"
+#include "TROOT.h"
+#include "distributions.h"
+#include "output.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,26,0)
+using ROOT::TBufferMerger;
+using ROOT::TBufferMergerFile;
+#else
+using ROOT::Experimental::TBufferMerger;
+using ROOT::Experimental::TBufferMergerFile;
+#endif
+
+
+void WriteDistributions(const std::vector<Distribution*>& dists,
+                        const std::string& filename, size_t nthreads) {
+  WriteDistributions(dists, std::vector<std::string>(dists.size()), filename, nthreads);
+}
+
+
+void WriteDistributions(const std::vector<Distribution*>& dists,
+                        const std::vector<std::string>& dirnames,
+                        const std::string& filename, size_t nthreads) {
+  nthreads = std::max<size_t>(1, std::min(nthreads, dists.size()));
+
+  // Each thread takes the next unwritten distribution into its own memory
+  // file; the merger appends each memory file to the output when written,
+  // merging directories of the same name. gDirectory is per thread, so
+  // Distribution::Write lands in the right one.
+  TBufferMerger merger(filename.c_str(), "RECREATE");
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (size_t i=0; i<nthreads; i++) {
+    workers.emplace_back([&]() {
+      std::shared_ptr<TBufferMergerFile> file = merger.GetFile();
+      for (size_t j=next++; j<dists.size(); j=next++) {
+        if (dirnames[j].empty()) {
+          file->cd();
+        }
+        else {
+          TDirectory* dir = file->GetDirectory(dirnames[j].c_str());
+          (dir ? dir : file->mkdir(dirnames[j].c_str()))->cd();
+        }
+        dists[j]->Write();
+      }
+      file->Write();
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+
+void SaveDistributions(const std::vector<Distribution*>& dists, size_t nworkers) {
+  if (dists.empty()) {
+    return;
+  }
+  nworkers = std::max<size_t>(1, std::min(nworkers, dists.size()));
+  gROOT->SetBatch(true);
+
+  std::cout << "RENDER " << dists.size() << " plots, " << nworkers << " workers" << std::endl;
+
+  // Workers are forked, so each has its own copy of the canvas (made on its
+  // first plot and reused for the rest) and of the histograms
+  ROOT::TProcessExecutor pool(nworkers);
+  pool.Map([&](int j) {
+    static TCanvas* canvas = nullptr;
+    if (!canvas) {
+      canvas = new TCanvas("c_render", "", 500, 500);
+    }
+    dists[j]->Save(canvas);
+    return 0;
+  }, ROOT::TSeqI(dists.size()));
+}
@@ -0,0 +1,53 @@
+#ifndef __OUTPUT__
+#define __OUTPUT__
+
+/**
+ * Output stage of the plotters: the ROOT file and the PNGs.
+ *
+ * Writing ~150 histograms (some large 2D ones, with their weight channels)
+ * one after another, then drawing each on a fresh canvas, can take longer
+ * than the event loop. The histograms are instead serialized by a pool of
+ * threads into in-memory files merged into the output by a TBufferMerger,
+ * and the PNGs are rendered in batch mode by a pool of worker processes
+ * (ROOT graphics are not thread-safe), each reusing one canvas.
+ */
+
+#include <string>
+#include <vector>
+
+struct Distribution;
+
+/**
+ * Write distributions to a new ROOT file (see Distribution::Write).
+ *
+ * ROOT::EnableThreadSafety must have been called.
+ *
+ * \param dists The distributions
+ * \param filename Output file, recreated
+ * \param nthreads Number of writer threads
+ */
+void WriteDistributions(const std::vector<Distribution*>& dists,
+                        const std::string& filename, size_t nthreads);
+
+/**
+ * Write distributions to a new ROOT file, each in a directory.
+ *
+ * \param dists The distributions
+ * \param dirnames Directory of each distribution, made if needed ("" for
+ *                 the top of the file)
+ * \param filename Output file, recreated
+ * \param nthreads Number of writer threads
+ */
+void WriteDistributions(const std::vector<Distribution*>& dists,
+                        const std::vector<std::string>& dirnames,
+                        const std::string& filename, size_t nthreads);
+
+/**
+ * Render distributions to PNGs (see Distribution::Save), in batch mode.
+ *
+ * \param dists The distributions
+ * \param nworkers Number of worker processes
+ */
+void SaveDistributions(const std::vector<Distribution*>& dists, size_t nworkers);
+
+#endif  // __OUTPUT__
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "ROOT/TProcessExecutor.hxx"
+#include "ROOT/TSeq.hxx"
+#include "TCanvas.h"
+#include "TClass.h"
+#include "TColor.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TLegend.h"
+#include "TList.h"
+#include "TROOT.h"
+#include "TVirtualPad.h"
+#include "overlay.h"
+
+namespace {
+
+  // Line color and style of each sample
+  void MakePalette(size_t n, std::vector<int>& colors, std::vector<int>& styles) {
+    const int basecolors[] = { kRed, kBlue, kOrange-3, kMagenta+2, kGreen+2 };
+    const int basestyles[] = { 1, 9, 2, 3, 4 };
+    for (size_t i=0; i<n; i++) {
+      if (i < 5) {
+        colors.push_back(basecolors[i]);
+        styles.push_back(basestyles[i]);
+        continue;
+      }
+      // Golden angle steps keep consecutive samples far apart in hue
+      float r, g, b;
+      TColor::HLS2RGB(std::fmod(137.508f * i, 360.f), 0.45, 0.8, r, g, b);
+      colors.push_back(TColor::GetColor(r, g, b));
+      styles.push_back(1 + i % 10);
+    }
+  }
+
+  // "PREFIX_<hname after its first _>[_SUFFIX]", with spaces as _
+  std::string PlotName(const std::string& prefix, const std::string& hname,
+                       const std::string& suffix="") {
+    std::string name = prefix;
+    size_t pos = hname.find('_');
+    if (pos != std::string::npos) {
+      name += hname.substr(pos);
+    }
+    if (!suffix.empty()) {
+      name += "_" + suffix;
+    }
+    for (char& c : name) {
+      if (c == ' ') c = '_';
+    }
+    return name + ".png";
+  }
+
+  // Draw all samples of a 1D histogram together
+  void Draw1D(TCanvas* c, const std::string& hname, const std::vector<TH1*>& ov,
+              const std::vector<std::string>& titles,
+              const std::vector<int>& colors, const std::vector<int>& styles) {
+    c->Clear();
+    c->cd();
+    c->SetLeftMargin(0.15);
+    c->SetRightMargin(0.1);
+
+    double ymax = 0;
+    for (size_t i=0; i<ov.size(); i++) {
+      if (!ov[i]) continue;
+      ov[i]->SetLineColor(colors[i]);
+      ov[i]->SetLineWidth(4);
+      ov[i]->SetLineStyle(styles[i]);
+      ymax = std::max(ymax, ov[i]->GetMaximum());
+    }
+    ov[0]->GetYaxis()->SetRangeUser(0, 1.5 * ymax);
+    ov[0]->Draw("e1");
+
+    TLegend legend(0.5, 0.65, 0.88, 0.88);
+    legend.SetBorderSize(0);
+    legend.SetFillColor(0);
+    legend.SetFillStyle(0);
+    for (size_t i=0; i<ov.size(); i++) {
+      if (!ov[i]) continue;
+      ov[i]->Draw("e1 same");
+      legend.AddEntry(ov[i], titles[i].c_str());
+    }
+    legend.Draw();
+    c->SaveAs(PlotName("cmp", hname).c_str());
+  }
+
+  // Comparisons are hard to read for 2D plots: draw each sample on its own,
+  // and next to its ratio to the first sample
+  void Draw2D(TCanvas* c, const std::string& hname, const std::vector<TH1*>& ov,
+              const std::vector<std::string>& titles) {
+    for (size_t i=0; i<ov.size(); i++) {
+      if (!ov[i]) continue;
+      ov[i]->SetTitle((std::string(ov[i]->GetTitle()) + " " + titles[i]).c_str());
+      ov[i]->GetZaxis()->SetTitleOffset(1.15);
+
+      c->Clear();
+      c->cd();
+      c->SetLeftMargin(0.15);
+      c->SetRightMargin(0.17);
+      ov[i]->Draw("colz");
+      c->SaveAs(PlotName("nocmp2d", hname, titles[i]).c_str());
+
+      if (i == 0) continue;
+      TH1* ratio = (TH1*)ov[i]->Clone();
+      ratio->Divide(ov[0]);
+      ratio->SetTitle((std::string(ov[i]->GetTitle()) + " / " + titles[0]).c_str());
+      ratio->GetZaxis()->SetTitle(("Ratio " + titles[i] + "/" + titles[0]).c_str());
+      ratio->SetMinimum(0);
+      ratio->SetMaximum(2);
+
+      c->Clear();
+      c->Divide(2, 1);
+      for (int pad=1; pad<=2; pad++) {
+        TVirtualPad* p = c->cd(pad);
+        p->SetLeftMargin(0.15);
+        p->SetRightMargin(0.17);
+        (pad == 1 ? ov[i] : ratio)->Draw("colz");
+      }
+      c->SaveAs(PlotName("ratio2d", hname, titles[i]).c_str());
+      c->Clear();
+      delete ratio;
+    }
+  }
+
+}  // namespace
+
+
+bool LoadSamples(const std::vector<std::string>& filenames,
+                 const std::vector<std::string>& titles, bool normalize,
+                 Samples& samples) {
+  samples.titles = titles;
+  samples.hists.assign(filenames.size(), std::map<std::string, TH1*>());
+  samples.names.clear();
+  for (size_t i=0; i<filenames.size(); i++) {
+    std::cout << "FILE " << filenames[i] << " (" << titles[i] << ")" << std::endl;
+
+    // "FILE.root:DIR" is the sample in directory DIR of a multi-sample
+    // output of plot_kinematics_nuistr (see -l)
+    std::string path = filenames[i];
+    std::string dirname;
+    size_t pos = path.find(".root:");
+    if (pos != std::string::npos) {
+      dirname = path.substr(pos + 6);
+      path = path.substr(0, pos + 5);
+    }
+    TFile f(path.c_str(), "READ");
+    if (!f.IsOpen()) {
+      std::cout << "Error: cannot open " << path << std::endl;
+      return false;
+    }
+    TDirectory* dir = dirname.empty() ? &f : f.GetDirectory(dirname.c_str());
+    if (!dir) {
+      std::cout << "Error: no directory " << dirname << " in " << path << std::endl;
+      return false;
+    }
+    TIter next(dir->GetListOfKeys());
+    while (TKey* key = (TKey*)next()) {
+      // Only histograms are compared (e.g. not the THnSparse q0/q3/Enu
+      // tables). Keys are in decreasing cycle order, so keep the first.
+      TClass* cls = TClass::GetClass(key->GetClassName());
+      if (!cls || !cls->InheritsFrom("TH1") || samples.hists[i].count(key->GetName())) {
+        continue;
+      }
+      TH1* h = (TH1*)key->ReadObj();
+      h->SetDirectory(nullptr);
+      if (normalize && h->Integral() != 0) {
+        h->Scale(1.0 / h->Integral());
+      }
+      samples.hists[i][key->GetName()] = h;
+      if (i == 0) {
+        samples.names.push_back(key->GetName());
+      }
+    }
+  }
+  return true;
+}
+
+
+void RenderOverlays(const Samples& samples, const std::vector<std::string>& names,
+                    size_t nworkers) {
+  if (names.empty()) {
+    return;
+  }
+  gROOT->SetBatch(true);
+  nworkers = std::max<size_t>(1, std::min(nworkers, names.size()));
+  std::cout << "RENDER " << names.size() << " plots, " << nworkers << " workers" << std::endl;
+
+  std::vector<int> colors, styles;
+  MakePalette(samples.hists.size(), colors, styles);
+
+  // Workers are forked, so each has its own copies of the histograms and of
+  // its canvas (made on its first plot and reused for the rest)
+  ROOT::TProcessExecutor pool(nworkers);
+  pool.Map([&](int j) {
+    static TCanvas* c = nullptr;
+    if (!c) {
+      c = new TCanvas("c_overlay", "", 1500, 1500);
+    }
+
+    const std::string& hname = names[j];
+    std::vector<TH1*> ov;
+    for (const auto& hists : samples.hists) {
+      auto it = hists.find(hname);
+      ov.push_back(it == hists.end() ? nullptr : it->second);
+    }
+    if (!ov[0]) {
+      return 0;
+    }
+    std::cout << "OBJ " << hname << std::endl;
+
+    if (ov[0]->GetDimension() == 1) {
+      Draw1D(c, hname, ov, samples.titles, colors, styles);
+    }
+    else if (ov[0]->GetDimension() == 2) {
+      Draw2D(c, hname, ov, samples.titles);
+    }
+    return 0;
+  }, ROOT::TSeqI(names.size()));
+}
@@ -0,0 +1,62 @@
+#ifndef __OVERLAY__
+#define __OVERLAY__
+
+/**
+ * Overlays of the histograms of several plotter outputs.
+ *
+ * Shared by compare (all histograms) and diff_plots (only those that
+ * changed). 1D histograms from all samples are drawn together
+ * ("cmp_<name>.png"), and each sample's 2D histogram is drawn on its own
+ * ("nocmp2d_<name>_<title>.png") and, for all but the first sample, next to
+ * its ratio to the first ("ratio2d_<name>_<title>.png"). Names drop the
+ * histogram's type prefix (e.g. "hq2_").
+ *
+ * Plots are rendered in batch mode by a pool of worker processes (ROOT
+ * graphics are not thread-safe), each reusing one canvas. Any number of
+ * samples can be drawn: past the first five (which keep the historical
+ * colors and line styles), colors are spread around the hue circle.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+class TH1;
+
+/**
+ * \struct Samples
+ * \brief The histograms of several plotter outputs, read once.
+ */
+struct Samples {
+  std::vector<std::string> titles;  //!< Legend title of each sample
+  std::vector<std::map<std::string, TH1*> > hists;  //!< Histograms of each sample, by name
+  std::vector<std::string> names;  //!< Histogram names in the first sample, in key order
+};
+
+
+/**
+ * Read every histogram (TH1 and derived classes) of each file.
+ *
+ * \param filenames The plotter outputs, as "FILE.root" or, for one sample of
+ *                  a multi-sample output, "FILE.root:LABEL"
+ * \param titles Legend title of each
+ * \param normalize Scale each histogram to unit area
+ * \param samples Filled with the histograms
+ * \returns False if a file could not be opened
+ */
+bool LoadSamples(const std::vector<std::string>& filenames,
+                 const std::vector<std::string>& titles, bool normalize,
+                 Samples& samples);
+
+
+/**
+ * Render the overlays of some of the histograms.
+ *
+ * \param samples The samples
+ * \param names The histograms to draw
+ * \param nworkers Number of worker processes
+ */
+void RenderOverlays(const Samples& samples, const std::vector<std::string>& names,
+                    size_t nworkers);
+
+#endif  // __OVERLAY__
@@ -6,10 +6,17 @@
  * A. Mastbaum <mastbaum@uchicago.edu>, 2018/12/19
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include "TCanvas.h"
 #include "TFile.h"
@@ -17,6 +24,7 @@
 #include "TH2F.h"
 #include "TH3F.h"
 #include "TMath.h"
+#include "TROOT.h"
 #include "TStyle.h"
 #include "gallery/Event.h"
 #include "gallery/ValidHandle.h"
@@ -24,16 +32,22 @@
 #include "canvas/Utilities/InputTag.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 #include "nusimdata/SimulationBase/MCNeutrino.h"
+#include "binarena.h"
 #include "distributions.h"
+#include "eventview.h"
 #include "filter.h"
+#include "output.h"
+#include "plotset.h"
+#include "scheduler.h"
 
 int main(int argc, char* argv[]) {
   // Parse command-line arguments
   if (argc < 3) {
     std::cout << "Usage: " << argv[0] << " "
-              << "OUTPUT.root INPUT.root [INPUT2.root ...]" << std::endl
+              << "OUTPUT.root [-j NTHREADS] [-n] INPUT.root [INPUT2.root ...]" << std::endl
 	      << "Or: " << argv[0] << " "
-	      << "OUTPUT.root -f INPUTLIST.root" << std::endl;
+	      << "OUTPUT.root [-j NTHREADS] [-n] -f INPUTLIST.root" << std::endl
+	      << "With -n, no PNGs are rendered." << std::endl;
     return 0;
   }
 
@@ -42,9 +56,17 @@ int main(int argc, char* argv[]) {
 
   std::string outfile = argv[1];
   std::vector<std::string> filename;
+  size_t nthreads = std::thread::hardware_concurrency();
+  bool render = true;
   for (int i=2; i<argc; i++) {
     std::string arg = argv[i];
-    if (arg == "-f"){
+    if (arg == "-j" && i+1 < argc){
+      nthreads = std::atoi(argv[++i]);
+    }
+    else if (arg == "-n"){
+      render = false;
+    }
+    else if (arg == "-f"){
       std::ifstream inputlist(argv[i+1]);
       std::string line;
       while (getline (inputlist, line)){
@@ -60,221 +82,103 @@ int main(int argc, char* argv[]) {
   }
 
 
-  // Define event filters
-  filters::NuMode* filt_num_ccqe = new filters::NuMode(14, enums::kCC, enums::kQE);
-  filters::NuMode* filt_nue_ccqe = new filters::NuMode(12, enums::kCC, enums::kQE);
-  filters::NuMode* filt_num_ccmec = new filters::NuMode(14, enums::kCC, enums::kMEC);
-  filters::NuMode* filt_num_ccres = new filters::NuMode(14, enums::kCC, enums::kRes);
-
-  filters::NuMode* filt_num_nc = new filters::NuMode(14, enums::kNC, enums::kUndefined);
-  filters::NuMode* filt_nue_nc = new filters::NuMode(12, enums::kNC, enums::kUndefined);
-
-  // Define distributions (plots)
-  std::vector<Distribution*> dists = {
-    // numCCQE
-    new distributions::Q2("num_ccqe_q2", filt_num_ccqe),
-    new distributions::Q0Q3("num_ccqe_q0q3", filt_num_ccqe),
-    new distributions::LeadPKEQ0("num_ccqe_pkeq0", filt_num_ccqe),
-    new distributions::TheoristsW("num_ccqe_thw", filt_num_ccqe),
-    new distributions::TheoristsBjorkenX("num_ccqe_thbjorkenx", filt_num_ccqe),
-    new distributions::TheoristsInelasticityY("num_ccqe_thinely", filt_num_ccqe),
-    new distributions::ExperimentalistsW("num_ccqe_expw", filt_num_ccqe),
-    new distributions::ExperimentalistsBjorkenX("num_ccqe_expbjorkenx", filt_num_ccqe),
-    new distributions::ExperimentalistsInelasticityY("num_ccqe_expinely", filt_num_ccqe),
-    new distributions::TheoristsNu("num_ccqe_thnu",filt_num_ccqe),
-    new distributions::ExperimentalistsNu("num_ccqe_expnu",filt_num_ccqe),
-    new distributions::BindingE("num_ccqe_be",filt_num_ccqe),
-    new distributions::PLep("num_ccqe_plep", filt_num_ccqe),
-    new distributions::ThetaLep("num_ccqe_tlep", filt_num_ccqe),
-    new distributions::PThetaLep("num_ccqe_ptlep", filt_num_ccqe),
-    new distributions::PPLead("num_ccqe_pp", filt_num_ccqe),
-    new distributions::ThetaPLead("num_ccqe_tp", filt_num_ccqe),
-    new distributions::ThetaPLead("num_ccqe_tp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::ThetaLepPLead("num_ccqe_tlepp", filt_num_ccqe),
-    new distributions::ThetaLepPLead("num_ccqe_tlepp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::dPhiLepPLead("num_ccqe_dphilp", filt_num_ccqe),
-    new distributions::dPhiLepPLead("num_ccqe_dphilp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::Mult("num_ccqe_multp", filt_num_ccqe, 2212),
-    new distributions::Mult("num_ccqe_multp_30MeV", filt_num_ccqe, 2212, 0.03),
-    new distributions::Mult("num_ccqe_multn", filt_num_ccqe, 2112),
-    new distributions::Mult("num_ccqe_multpip", filt_num_ccqe, 211),
-    new distributions::Mult("num_ccqe_multpim", filt_num_ccqe, -211),
-    new distributions::Mult("num_ccqe_multpi0", filt_num_ccqe, 111),
-    new distributions::Mult("num_ccqe_multkp", filt_num_ccqe, 321),
-    new distributions::Mult("num_ccqe_multkm", filt_num_ccqe, -321),
-    new distributions::Mult("num_ccqe_multk0", filt_num_ccqe, 311),
-
-    // nueCCQE
-    new distributions::Q2("nue_ccqe_q2", filt_nue_ccqe),
-    new distributions::Q0Q3("nue_ccqe_q0q3", filt_nue_ccqe),
-    new distributions::ECons("nue_ccqe_econs", filt_nue_ccqe),
-    new distributions::LeadPKEQ0("nue_ccqe_pkeq0", filt_nue_ccqe),
-    new distributions::TheoristsW("nue_ccqe_thw", filt_nue_ccqe),
-    new distributions::TheoristsBjorkenX("nue_ccqe_thbjorkenx", filt_nue_ccqe),
-    new distributions::TheoristsInelasticityY("nue_ccqe_thinely", filt_nue_ccqe),
-    new distributions::ExperimentalistsW("nue_ccqe_expw", filt_nue_ccqe),
-    new distributions::ExperimentalistsBjorkenX("nue_ccqe_expbjorkenx", filt_nue_ccqe),
-    new distributions::ExperimentalistsInelasticityY("nue_ccqe_expinely", filt_nue_ccqe),
-    new distributions::TheoristsNu("nue_ccqe_thnu",filt_nue_ccqe),
-    new distributions::ExperimentalistsNu("nue_ccqe_expnu",filt_nue_ccqe),
-    new distributions::BindingE("nue_ccqe_be",filt_nue_ccqe),
-    new distributions::PLep("nue_ccqe_plep", filt_nue_ccqe),
-    new distributions::ThetaLep("nue_ccqe_tlep", filt_nue_ccqe),
-    new distributions::PThetaLep("nue_ccqe_ptlep", filt_nue_ccqe),
-    new distributions::PPLead("nue_ccqe_pp", filt_nue_ccqe),
-    new distributions::ThetaPLead("nue_ccqe_tp", filt_nue_ccqe),
-    new distributions::ThetaPLead("nue_ccqe_tp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::ThetaLepPLead("nue_ccqe_tlepp", filt_nue_ccqe),
-    new distributions::ThetaLepPLead("nue_ccqe_tlepp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::dPhiLepPLead("nue_ccqe_dphilp", filt_nue_ccqe),
-    new distributions::dPhiLepPLead("nue_ccqe_dphilp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::Mult("nue_ccqe_multp", filt_nue_ccqe, 2212),
-    new distributions::Mult("nue_ccqe_multp_30MeV", filt_nue_ccqe, 2212, 0.03),
-    new distributions::Mult("nue_ccqe_multn", filt_nue_ccqe, 2112),
-    new distributions::Mult("nue_ccqe_multpip", filt_nue_ccqe, 211),
-    new distributions::Mult("nue_ccqe_multpim", filt_nue_ccqe, -211),
-    new distributions::Mult("nue_ccqe_multpi0", filt_nue_ccqe, 111),
-    new distributions::Mult("nue_ccqe_multkp", filt_nue_ccqe, 321),
-    new distributions::Mult("nue_ccqe_multkm", filt_nue_ccqe, -321),
-    new distributions::Mult("nue_ccqe_multk0", filt_nue_ccqe, 311),
-
-    // numCCMEC
-    new distributions::Q0Q3("num_ccmec_q0q3", filt_num_ccmec),
-    new distributions::Pke("num_ccmec_ppp", filt_num_ccmec),
-    new distributions::PPLead("num_ccmec_pp", filt_num_ccmec),
-    new distributions::ThetaPLead("num_ccmec_tp", filt_num_ccmec),
-    new distributions::ThetaPLead("num_ccmec_tp_40MeV", filt_num_ccmec, 0.04),
-    new distributions::ThetaLepPLead("num_ccmec_tlepp", filt_num_ccmec),
-    new distributions::ThetaLepPLead("num_ccmec_tlepp_40MeV", filt_num_ccmec, 0.04),
-    new distributions::dPhiLepPLead("num_ccmec_dphilp", filt_num_ccmec),
-    new distributions::dPhiLepPLead("num_ccmec_dphilp_40MeV", filt_num_ccmec, 0.04),
-
-    // numCCRes
-    new distributions::Q0Q3("num_ccres_q0q3", filt_num_ccres),
-    new distributions::TheoristsW("num_ccres_thw", filt_num_ccres),
-    new distributions::TheoristsBjorkenX("num_ccres_thbjorkenx", filt_num_ccres),
-    new distributions::TheoristsInelasticityY("num_ccres_thinely", filt_num_ccres),
-    new distributions::ExperimentalistsW("num_ccres_expw", filt_num_ccres),
-    new distributions::ExperimentalistsBjorkenX("num_ccres_expbjorkenx", filt_num_ccres),
-    new distributions::ExperimentalistsInelasticityY("num_ccres_expinely", filt_num_ccres),
-    new distributions::TheoristsNu("num_ccres_thnu",filt_num_ccres),
-    new distributions::ExperimentalistsNu("num_ccres_expnu",filt_num_ccres),
-    new distributions::BindingE("num_ccres_be",filt_num_ccres),
-    new distributions::PLep("num_ccres_plep", filt_num_ccres),
-    new distributions::ThetaLep("num_ccres_tlep", filt_num_ccres),
-    new distributions::PThetaLep("num_ccres_ptlep", filt_num_ccres),
-    new distributions::PPiLead("num_ccres_ppi", filt_num_ccres),
-    new distributions::ThetaPiLead("num_ccres_tpi", filt_num_ccres),
-    new distributions::ThetaLepPiLead("num_ccres_tlpi", filt_num_ccres),
-    new distributions::PPLead("num_ccres_pp", filt_num_ccres),
-    new distributions::ThetaPLead("num_ccres_tp", filt_num_ccres),
-    new distributions::ThetaPLead("num_ccres_tp_40MeV", filt_num_ccres, 0.04),
-    new distributions::ThetaLepPLead("num_ccres_tlepp", filt_num_ccres),
-    new distributions::ThetaLepPLead("num_ccres_tlepp_40MeV", filt_num_ccres, 0.04),
-    new distributions::dPhiLepPLead("num_ccres_dphilp", filt_num_ccres),
-    new distributions::dPhiLepPLead("num_ccres_dphilp_40MeV", filt_num_ccres, 0.04),
-    new distributions::Mult("nue_ccres_multp", filt_num_ccres, 2212),
-    new distributions::Mult("nue_ccres_multn", filt_num_ccres, 2112),
-    new distributions::Mult("nue_ccres_multpip", filt_num_ccres, 211),
-    new distributions::Mult("nue_ccres_multpim", filt_num_ccres, -211),
-    new distributions::Mult("nue_ccres_multpi0", filt_num_ccres, 111),
-    new distributions::Mult("nue_ccres_multkp", filt_num_ccres, 321),
-    new distributions::Mult("nue_ccres_multkm", filt_num_ccres, -321),
-    new distributions::Mult("nue_ccres_multk0", filt_num_ccres, 311),
+  // Histograms are per-thread and merged at the end, so keep them out of
+  // gDirectory (which is shared, and would see the same names many times)
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(false);
+
+  // Split each art file into runs of events, so that a slow file (e.g. one
+  // of DIS events) is shared out. Seeking needs gallery::Event's
+  // numberOfEventsInFile and goToEntry; gallery releases without them
+  // cannot build this.
+  Scheduler scheduler(nthreads);
+  const long long kChunk = 500;
+  for (size_t i=0; i<filename.size(); i++) {
+    long long nentries = gallery::Event({ filename[i] }).numberOfEventsInFile();
+    std::vector<std::pair<long long, long long> > chunks;
+    for (long long first=0; first<nentries; first+=kChunk) {
+      chunks.push_back(std::make_pair(first, std::min(first+kChunk, nentries)));
+    }
+    scheduler.AddClusters(i, chunks, kChunk);
+  }
 
-    // numNC
-    new distributions::Q2("num_nc_q2", filt_num_nc),
-    new distributions::Q0Q3("num_nc_q0q3", filt_num_nc),
-    new distributions::TheoristsW("num_nc_thw", filt_num_nc),
-    new distributions::TheoristsBjorkenX("num_nc_thbjorkenx", filt_num_nc),
-    new distributions::TheoristsInelasticityY("num_nc_thinely", filt_num_nc),
-    new distributions::ExperimentalistsW("num_nc_expw", filt_num_nc),
-    new distributions::ExperimentalistsBjorkenX("num_nc_expbjorkenx", filt_num_nc),
-    new distributions::ExperimentalistsInelasticityY("num_nc_expinely", filt_num_nc),
-    new distributions::TheoristsNu("num_nc_thnu",filt_num_nc),
-    new distributions::ExperimentalistsNu("num_nc_expnu",filt_num_nc),
-    new distributions::PPLead("num_nc_pp", filt_num_nc),
-    new distributions::ThetaPLead("num_nc_tp", filt_num_nc),
-    new distributions::ThetaPLead("num_nc_tp_40MeV", filt_num_nc, 0.04),
-    new distributions::ThetaLepPLead("num_nc_tlepp", filt_num_nc),
-    new distributions::ThetaLepPLead("num_nc_tlepp_40MeV", filt_num_nc, 0.04),
-    new distributions::Mult("num_nc_multp", filt_num_nc, 2212),
-    new distributions::Mult("num_nc_multp_30MeV", filt_num_nc, 2212, 0.03),
-    new distributions::Mult("num_nc_multn", filt_num_nc, 2112),
-    new distributions::Mult("num_nc_multpip", filt_num_nc, 211),
-    new distributions::Mult("num_nc_multpim", filt_num_nc, -211),
-    new distributions::Mult("num_nc_multpi0", filt_num_nc, 111),
-    new distributions::Mult("num_nc_multkp", filt_num_nc, 321),
-    new distributions::Mult("num_nc_multkm", filt_num_nc, -321),
-    new distributions::Mult("num_nc_multk0", filt_num_nc, 311),
+  // One full set of distributions per worker thread, with its bin sums in
+  // one block
+  std::vector<std::vector<Distribution*> > dists;
+  std::vector<std::unique_ptr<BinArena> > arenas;
+  for (size_t i=0; i<scheduler.nthreads; i++) {
+    dists.push_back(MakeDistributions());
+    arenas.emplace_back(new BinArena);
+    arenas[i]->Attach(dists[i]);
+  }
+  std::cout << "ARENA " << arenas[0]->GetSize() / 1024 << " kB per thread" << std::endl;
 
-    // nueNC
-    new distributions::Q2("nue_nc_q2", filt_nue_nc),
-    new distributions::Q0Q3("nue_nc_q0q3", filt_nue_nc),
-    new distributions::TheoristsW("nue_nc_thw", filt_nue_nc),
-    new distributions::TheoristsBjorkenX("nue_nc_thbjorkenx", filt_nue_nc),
-    new distributions::TheoristsInelasticityY("nue_nc_thinely", filt_nue_nc),
-    new distributions::ExperimentalistsW("nue_nc_expw", filt_nue_nc),
-    new distributions::ExperimentalistsBjorkenX("nue_nc_expbjorkenx", filt_nue_nc),
-    new distributions::ExperimentalistsInelasticityY("nue_nc_expinely", filt_nue_nc),
-    new distributions::TheoristsNu("nue_nc_thnu",filt_nue_nc),
-    new distributions::ExperimentalistsNu("nue_nc_expnu",filt_nue_nc),
-    new distributions::PPLead("nue_nc_pp", filt_nue_nc),
-    new distributions::ThetaPLead("nue_nc_tp", filt_nue_nc),
-    new distributions::ThetaPLead("nue_nc_tp_40MeV", filt_nue_nc, 0.04),
-    new distributions::ThetaLepPLead("nue_nc_tlepp", filt_nue_nc),
-    new distributions::ThetaLepPLead("nue_nc_tlepp_40MeV", filt_nue_nc, 0.04),
-    new distributions::Mult("nue_nc_multp", filt_nue_nc, 2212),
-    new distributions::Mult("nue_nc_multp_30MeV", filt_nue_nc, 2212, 0.03),
-    new distributions::Mult("nue_nc_multn", filt_nue_nc, 2112),
-    new distributions::Mult("nue_nc_multpip", filt_nue_nc, 211),
-    new distributions::Mult("nue_nc_multpim", filt_nue_nc, -211),
-    new distributions::Mult("nue_nc_multpi0", filt_nue_nc, 111),
-    new distributions::Mult("nue_nc_multkp", filt_nue_nc, 321),
-    new distributions::Mult("nue_nc_multkm", filt_nue_nc, -321),
-    new distributions::Mult("nue_nc_multk0", filt_nue_nc, 311)
+  // Each worker keeps its current input open until it is handed a task
+  // from a different file
+  struct Input {
+    size_t file;
+    std::unique_ptr<gallery::Event> ev;
   };
-
-  size_t nevents = 0;
+  std::vector<Input> inputs(scheduler.nthreads);
+  std::mutex iomutex;
+  std::atomic<size_t> nevents(0);
 
   // Event loop
-  for (gallery::Event ev(filename) ; !ev.atEnd(); ev.next()) {
-    if (nevents % 100 == 0) {
-      std::cout << "EVENT " << nevents << std::endl;
+  scheduler.Run([&](size_t thread, const Task& task) {
+    Input& input = inputs[thread];
+    if (!input.ev || input.file != task.file) {
+      input.ev.reset(new gallery::Event({ filename[task.file] }));
+      input.file = task.file;
     }
-    nevents++;
+    gallery::Event& ev = *input.ev;
+    ev.goToEntry(task.first);
+    for (long long entry=task.first; entry<task.last && !ev.atEnd(); entry++, ev.next()) {
+      size_t ievent = nevents++;
+      if (ievent % 100 == 0) {
+        std::lock_guard<std::mutex> lock(iomutex);
+        std::cout << "EVENT " << ievent << std::endl;
+      }
 
-    gallery::Handle<std::vector<simb::MCTruth> > mctruths;
-    ev.getByLabel({"generator::HepMCNuWro"}, mctruths);
-    if (mctruths.isValid()){
-      //std::cout << "Looking at NuWro events." << std::endl;
-    }
-    else{
-      std::cout << "Looking at GENIE events" << std::endl;
-      ev.getByLabel({"generator"},mctruths);
-    }
+      gallery::Handle<std::vector<simb::MCTruth> > mctruths;
+      ev.getByLabel({"generator::HepMCNuWro"}, mctruths);
+      if (mctruths.isValid()){
+        //std::cout << "Looking at NuWro events." << std::endl;
+      }
+      else{
+        std::lock_guard<std::mutex> lock(iomutex);
+        std::cout << "Looking at GENIE events" << std::endl;
+        ev.getByLabel({"generator"},mctruths);
+      }
 
-    for (size_t i=0, ntruth=mctruths->size(); i<ntruth; i++) {
+      for (size_t i=0, ntruth=mctruths->size(); i<ntruth; i++) {
 
-      const simb::MCTruth& mctruth = mctruths->at(i);
+        const simb::MCTruth& mctruth = mctruths->at(i);
 
-      for (Distribution* dist : dists) {
-        if ((*dist->filter)(mctruth)) {
-          dist->Fill(mctruth);
+        // Gather the final state and its derived columns once, for all the
+        // distributions
+        TruthView view(mctruth);
+        for (Distribution* dist : dists[thread]) {
+          if ((*dist->filter)(mctruth)) {
+            dist->Fill(view);
+          }
         }
       }
     }
+  });
+
+  // Merge the per-thread histograms into the first set
+  for (size_t i=1; i<dists.size(); i++) {
+    arenas[0]->Merge(*arenas[i]);
+    for (size_t j=0; j<dists[0].size(); j++) {
+      dists[0][j]->Merge(*dists[i][j]);
+    }
   }
 
   // Save histograms (to file and png)
-  TFile* fout = new TFile(outfile.c_str(), "recreate");
-  for (Distribution* dist : dists) {
-    if (dist->hist->GetEntries() > 0) {
-      dist->Write();
-      dist->Save();
-    }
+  WriteDistributions(dists[0], outfile, scheduler.nthreads);
+  if (render) {
+    SaveDistributions(dists[0], scheduler.nthreads);
   }
-  fout->Close();
 
   return 0;
 }
@@ -6,9 +6,16 @@
  * A. Mastbaum <mastbaum@uchicago.edu>, 2018/12/19
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include "TCanvas.h"
 #include "TFile.h"
@@ -16,16 +23,50 @@
 #include "TH2F.h"
 #include "TH3F.h"
 #include "TMath.h"
+#include "TROOT.h"
 #include "TStyle.h"
 #include "NuisTree.h"
+#include "binarena.h"
 #include "distributions.h"
+#include "entryindex.h"
+#include "eventstore.h"
 #include "filter.h"
+#include "output.h"
+#include "plotset.h"
+#include "resultcache.h"
+#include "scheduler.h"
+#include "zonemap.h"
 
 int main(int argc, char* argv[]) {
   // Parse command-line arguments
-  if (argc != 3) {
+  if (argc < 3) {
     std::cout << "Usage: " << argv[0] << " "
-              << "OUTPUT.root INPUT.root" << std::endl;
+              << "OUTPUT.root [-j NTHREADS] [-i] [-z] [-p] [-u NUNIVERSES] [-w WEIGHTSET,...] [-b NREPLICAS] [-s VAR:V1,V2,...] INPUT.root [INPUT2.root ...]" << std::endl
+              << "Or: " << argv[0] << " "
+              << "OUTPUT.root [-j NTHREADS] [-i] [-z] [-p] [-u NUNIVERSES] [-w WEIGHTSET,...] [-b NREPLICAS] [-s VAR:V1,V2,...] -f INPUTLIST.txt" << std::endl
+              << "Or: " << argv[0] << " "
+              << "OUTPUT.root [OPTIONS] -l LABEL1 INPUT.root [...] -l LABEL2 INPUT2.root [...] [...]" << std::endl
+              << "Inputs may be NUISANCE ROOT files or event stores made by make_eventstore." << std::endl
+              << "With -i, per-filter entry lists are saved next to ROOT inputs and used" << std::endl
+              << "on later runs to read only the entries that pass a filter." << std::endl
+              << "With -z, per-cluster summaries of Mode, PDGnu, cc and Enu_true are saved" << std::endl
+              << "next to ROOT inputs and used to skip clusters no filter can pass." << std::endl
+              << "With -p, each histogram is also rendered to hist_<name>.png." << std::endl
+              << "With -u, every histogram is also filled for the first NUNIVERSES entries" << std::endl
+              << "of CustomWeightArray, and the per-bin mean and RMS are written." << std::endl
+              << "With -w, every histogram is also filled under each weight set, a product" << std::endl
+              << "of Weight, InputWeight, RWWeight and CustomWeight (e.g. -w InputWeight,RWWeight)." << std::endl
+              << "With -b, NREPLICAS Poisson bootstrap replicas are filled, and their per-bin" << std::endl
+              << "mean and RMS (the MC statistical uncertainty) are written." << std::endl
+              << "With -s, every histogram is also written in slices of Enu_true (given by" << std::endl
+              << "edges, e.g. -s Enu_true:0,0.5,1,2) or tgt (one code per slice, e.g." << std::endl
+              << "-s tgt:1000060120,1000180400), as <name>_slice<k>." << std::endl
+              << "With -l, the inputs that follow (up to the next -l) are a separate sample," << std::endl
+              << "with its own histograms, written to the directory LABEL of the output." << std::endl
+              << "All samples are processed together, in one event loop." << std::endl
+              << "With -c, the histograms of each sample are stored in CACHEDIR, keyed on" << std::endl
+              << "its inputs, the plot configuration and this binary, and reused by later" << std::endl
+              << "runs instead of reading the sample's inputs again." << std::endl;
     return 0;
   }
 
@@ -33,213 +74,431 @@ int main(int argc, char* argv[]) {
   gStyle->SetHistLineColor(kBlack);
 
   std::string outfile = argv[1];
-  std::string infile = argv[2];
-
-  // Get tree from input file
-  TFile *fin = new TFile(infile.c_str(),"READ");
-  TTree *intree = (TTree*)fin->Get("GenericVectors__VARS");
-  NuisTree nuistr(intree);
-
-  // Define event filters
-  filters::NuMode* filt_num_ccqe = new filters::NuMode(14, enums::kCC, enums::kQE);
-  filters::NuMode* filt_nue_ccqe = new filters::NuMode(12, enums::kCC, enums::kQE);
-  filters::NuMode* filt_num_ccmec = new filters::NuMode(14,  enums::kCC,enums::kMEC);
-  filters::NuMode* filt_num_ccres = new filters::NuMode(14,  enums::kCC,enums::kRes);
-
-  filters::NuMode* filt_num_nc = new filters::NuMode(14, enums::kNC, enums::kUndefined);
-  filters::NuMode* filt_nue_nc = new filters::NuMode(12, enums::kNC, enums::kUndefined);
-
-  // Define distributions (plots)
-  std::vector<Distribution*> dists = {
-    // numCCQE
-    new distributions::Q2("num_ccqe_q2", filt_num_ccqe),
-    new distributions::Q0Q3("num_ccqe_q0q3", filt_num_ccqe),
-    new distributions::LeadPKEQ0("num_ccqe_pkeq0", filt_num_ccqe),
-    new distributions::TheoristsW("num_ccqe_thw", filt_num_ccqe),
-    new distributions::TheoristsBjorkenX("num_ccqe_thbjorkenx", filt_num_ccqe),
-    new distributions::TheoristsInelasticityY("num_ccqe_thinely", filt_num_ccqe),
-    new distributions::ExperimentalistsW("num_ccqe_expw", filt_num_ccqe),
-    new distributions::ExperimentalistsBjorkenX("num_ccqe_expbjorkenx", filt_num_ccqe),
-    new distributions::ExperimentalistsInelasticityY("num_ccqe_expinely", filt_num_ccqe),
-    new distributions::TheoristsNu("num_ccqe_thnu",filt_num_ccqe),
-    new distributions::ExperimentalistsNu("num_ccqe_expnu",filt_num_ccqe),
-    new distributions::BindingE("num_ccqe_be",filt_num_ccqe),
-    new distributions::PLep("num_ccqe_plep", filt_num_ccqe),
-    new distributions::ThetaLep("num_ccqe_tlep", filt_num_ccqe),
-    new distributions::PThetaLep("num_ccqe_ptlep", filt_num_ccqe),
-    new distributions::PPLead("num_ccqe_pp", filt_num_ccqe),
-    new distributions::ThetaPLead("num_ccqe_tp", filt_num_ccqe),
-    new distributions::ThetaPLead("num_ccqe_tp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::ThetaLepPLead("num_ccqe_tlepp", filt_num_ccqe),
-    new distributions::ThetaLepPLead("num_ccqe_tlepp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::dPhiLepPLead("num_ccqe_dphilp", filt_num_ccqe),
-    new distributions::dPhiLepPLead("num_ccqe_dphilp_40MeV", filt_num_ccqe, 0.04),
-    new distributions::Mult("num_ccqe_multp", filt_num_ccqe, 2212),
-    new distributions::Mult("num_ccqe_multp_30MeV", filt_num_ccqe, 2212, 0.03),
-    new distributions::Mult("num_ccqe_multn", filt_num_ccqe, 2112),
-    new distributions::Mult("num_ccqe_multpip", filt_num_ccqe, 211),
-    new distributions::Mult("num_ccqe_multpim", filt_num_ccqe, -211),
-    new distributions::Mult("num_ccqe_multpi0", filt_num_ccqe, 111),
-    new distributions::Mult("num_ccqe_multkp", filt_num_ccqe, 321),
-    new distributions::Mult("num_ccqe_multkm", filt_num_ccqe, -321),
-    new distributions::Mult("num_ccqe_multk0", filt_num_ccqe, 311),
-
-    // nueCCQE
-    new distributions::Q2("nue_ccqe_q2", filt_nue_ccqe),
-    new distributions::Q0Q3("nue_ccqe_q0q3", filt_nue_ccqe),
-    new distributions::ECons("nue_ccqe_econs", filt_nue_ccqe),
-    new distributions::LeadPKEQ0("nue_ccqe_pkeq0", filt_nue_ccqe),
-    new distributions::TheoristsW("nue_ccqe_thw", filt_nue_ccqe),
-    new distributions::TheoristsBjorkenX("nue_ccqe_thbjorkenx", filt_nue_ccqe),
-    new distributions::TheoristsInelasticityY("nue_ccqe_thinely", filt_nue_ccqe),
-    new distributions::ExperimentalistsW("nue_ccqe_expw", filt_nue_ccqe),
-    new distributions::ExperimentalistsBjorkenX("nue_ccqe_expbjorkenx", filt_nue_ccqe),
-    new distributions::ExperimentalistsInelasticityY("nue_ccqe_expinely", filt_nue_ccqe),
-    new distributions::TheoristsNu("nue_ccqe_thnu",filt_nue_ccqe),
-    new distributions::ExperimentalistsNu("nue_ccqe_expnu",filt_nue_ccqe),
-    new distributions::BindingE("nue_ccqe_be",filt_nue_ccqe),
-    new distributions::PLep("nue_ccqe_plep", filt_nue_ccqe),
-    new distributions::ThetaLep("nue_ccqe_tlep", filt_nue_ccqe),
-    new distributions::PThetaLep("nue_ccqe_ptlep", filt_nue_ccqe),
-    new distributions::PPLead("nue_ccqe_pp", filt_nue_ccqe),
-    new distributions::ThetaPLead("nue_ccqe_tp", filt_nue_ccqe),
-    new distributions::ThetaPLead("nue_ccqe_tp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::ThetaLepPLead("nue_ccqe_tlepp", filt_nue_ccqe),
-    new distributions::ThetaLepPLead("nue_ccqe_tlepp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::dPhiLepPLead("nue_ccqe_dphilp", filt_nue_ccqe),
-    new distributions::dPhiLepPLead("nue_ccqe_dphilp_40MeV", filt_nue_ccqe, 0.04),
-    new distributions::Mult("nue_ccqe_multp", filt_nue_ccqe, 2212),
-    new distributions::Mult("nue_ccqe_multp_30MeV", filt_nue_ccqe, 2212, 0.03),
-    new distributions::Mult("nue_ccqe_multn", filt_nue_ccqe, 2112),
-    new distributions::Mult("nue_ccqe_multpip", filt_nue_ccqe, 211),
-    new distributions::Mult("nue_ccqe_multpim", filt_nue_ccqe, -211),
-    new distributions::Mult("nue_ccqe_multpi0", filt_nue_ccqe, 111),
-    new distributions::Mult("nue_ccqe_multkp", filt_nue_ccqe, 321),
-    new distributions::Mult("nue_ccqe_multkm", filt_nue_ccqe, -321),
-    new distributions::Mult("nue_ccqe_multk0", filt_nue_ccqe, 311),
-
-    // numCCMEC
-    new distributions::Q0Q3("num_ccmec_q0q3", filt_num_ccmec),
-    new distributions::Pke("num_ccmec_ppp", filt_num_ccmec),
-    new distributions::PPLead("num_ccmec_pp", filt_num_ccmec),
-    new distributions::ThetaPLead("num_ccmec_tp", filt_num_ccmec),
-    new distributions::ThetaPLead("num_ccmec_tp_40MeV", filt_num_ccmec, 0.04),
-    new distributions::ThetaLepPLead("num_ccmec_tlepp", filt_num_ccmec),
-    new distributions::ThetaLepPLead("num_ccmec_tlepp_40MeV", filt_num_ccmec, 0.04),
-    new distributions::dPhiLepPLead("num_ccmec_dphilp", filt_num_ccmec),
-    new distributions::dPhiLepPLead("num_ccmec_dphilp_40MeV", filt_num_ccmec, 0.04),
-
-    // numCCRes
-    new distributions::Q0Q3("num_ccres_q0q3", filt_num_ccres),
-    new distributions::TheoristsW("num_ccres_thw", filt_num_ccres),
-    new distributions::TheoristsBjorkenX("num_ccres_thbjorkenx", filt_num_ccres),
-    new distributions::TheoristsInelasticityY("num_ccres_thinely", filt_num_ccres),
-    new distributions::ExperimentalistsW("num_ccres_expw", filt_num_ccres),
-    new distributions::ExperimentalistsBjorkenX("num_ccres_expbjorkenx", filt_num_ccres),
-    new distributions::ExperimentalistsInelasticityY("num_ccres_expinely", filt_num_ccres),
-    new distributions::TheoristsNu("num_ccres_thnu",filt_num_ccres),
-    new distributions::ExperimentalistsNu("num_ccres_expnu",filt_num_ccres),
-    new distributions::BindingE("num_ccres_be",filt_num_ccres),
-    new distributions::PLep("num_ccres_plep", filt_num_ccres),
-    new distributions::ThetaLep("num_ccres_tlep", filt_num_ccres),
-    new distributions::PThetaLep("num_ccres_ptlep", filt_num_ccres),
-    new distributions::PPiLead("num_ccres_ppi", filt_num_ccres),
-    new distributions::ThetaPiLead("num_ccres_tpi", filt_num_ccres),
-    new distributions::ThetaLepPiLead("num_ccres_tlpi", filt_num_ccres),
-    new distributions::PPLead("num_ccres_pp", filt_num_ccres),
-    new distributions::ThetaPLead("num_ccres_tp", filt_num_ccres),
-    new distributions::ThetaPLead("num_ccres_tp_40MeV", filt_num_ccres, 0.04),
-    new distributions::ThetaLepPLead("num_ccres_tlepp", filt_num_ccres),
-    new distributions::ThetaLepPLead("num_ccres_tlepp_40MeV", filt_num_ccres, 0.04),
-    new distributions::dPhiLepPLead("num_ccres_dphilp", filt_num_ccres),
-    new distributions::dPhiLepPLead("num_ccres_dphilp_40MeV", filt_num_ccres, 0.04),
-    new distributions::Mult("nue_ccres_multp", filt_num_ccres, 2212),
-    new distributions::Mult("nue_ccres_multn", filt_num_ccres, 2112),
-    new distributions::Mult("nue_ccres_multpip", filt_num_ccres, 211),
-    new distributions::Mult("nue_ccres_multpim", filt_num_ccres, -211),
-    new distributions::Mult("nue_ccres_multpi0", filt_num_ccres, 111),
-    new distributions::Mult("nue_ccres_multkp", filt_num_ccres, 321),
-    new distributions::Mult("nue_ccres_multkm", filt_num_ccres, -321),
-    new distributions::Mult("nue_ccres_multk0", filt_num_ccres, 311),
-
-    // numNC
-    new distributions::Q2("num_nc_q2", filt_num_nc),
-    new distributions::Q0Q3("num_nc_q0q3", filt_num_nc),
-    new distributions::TheoristsW("num_nc_thw", filt_num_nc),
-    new distributions::TheoristsBjorkenX("num_nc_thbjorkenx", filt_num_nc),
-    new distributions::TheoristsInelasticityY("num_nc_thinely", filt_num_nc),
-    new distributions::ExperimentalistsW("num_nc_expw", filt_num_nc),
-    new distributions::ExperimentalistsBjorkenX("num_nc_expbjorkenx", filt_num_nc),
-    new distributions::ExperimentalistsInelasticityY("num_nc_expinely", filt_num_nc),
-    new distributions::TheoristsNu("num_nc_thnu",filt_num_nc),
-    new distributions::ExperimentalistsNu("num_nc_expnu",filt_num_nc),
-    new distributions::PPLead("num_nc_pp", filt_num_nc),
-    new distributions::ThetaPLead("num_nc_tp", filt_num_nc),
-    new distributions::ThetaPLead("num_nc_tp_40MeV", filt_num_nc, 0.04),
-    new distributions::ThetaLepPLead("num_nc_tlepp", filt_num_nc),
-    new distributions::ThetaLepPLead("num_nc_tlepp_40MeV", filt_num_nc, 0.04),
-    new distributions::Mult("num_nc_multp", filt_num_nc, 2212),
-    new distributions::Mult("num_nc_multp_30MeV", filt_num_nc, 2212, 0.03),
-    new distributions::Mult("num_nc_multn", filt_num_nc, 2112),
-    new distributions::Mult("num_nc_multpip", filt_num_nc, 211),
-    new distributions::Mult("num_nc_multpim", filt_num_nc, -211),
-    new distributions::Mult("num_nc_multpi0", filt_num_nc, 111),
-    new distributions::Mult("num_nc_multkp", filt_num_nc, 321),
-    new distributions::Mult("num_nc_multkm", filt_num_nc, -321),
-    new distributions::Mult("num_nc_multk0", filt_num_nc, 311),
-
-    // nueNC
-    new distributions::Q2("nue_nc_q2", filt_nue_nc),
-    new distributions::Q0Q3("nue_nc_q0q3", filt_nue_nc),
-    new distributions::TheoristsW("nue_nc_thw", filt_nue_nc),
-    new distributions::TheoristsBjorkenX("nue_nc_thbjorkenx", filt_nue_nc),
-    new distributions::TheoristsInelasticityY("nue_nc_thinely", filt_nue_nc),
-    new distributions::ExperimentalistsW("nue_nc_expw", filt_nue_nc),
-    new distributions::ExperimentalistsBjorkenX("nue_nc_expbjorkenx", filt_nue_nc),
-    new distributions::ExperimentalistsInelasticityY("nue_nc_expinely", filt_nue_nc),
-    new distributions::TheoristsNu("nue_nc_thnu",filt_nue_nc),
-    new distributions::ExperimentalistsNu("nue_nc_expnu",filt_nue_nc),
-    new distributions::PPLead("nue_nc_pp", filt_nue_nc),
-    new distributions::ThetaPLead("nue_nc_tp", filt_nue_nc),
-    new distributions::ThetaPLead("nue_nc_tp_40MeV", filt_nue_nc, 0.04),
-    new distributions::ThetaLepPLead("nue_nc_tlepp", filt_nue_nc),
-    new distributions::ThetaLepPLead("nue_nc_tlepp_40MeV", filt_nue_nc, 0.04),
-    new distributions::Mult("nue_nc_multp", filt_nue_nc, 2212),
-    new distributions::Mult("nue_nc_multp_30MeV", filt_nue_nc, 2212, 0.03),
-    new distributions::Mult("nue_nc_multn", filt_nue_nc, 2112),
-    new distributions::Mult("nue_nc_multpip", filt_nue_nc, 211),
-    new distributions::Mult("nue_nc_multpim", filt_nue_nc, -211),
-    new distributions::Mult("nue_nc_multpi0", filt_nue_nc, 111),
-    new distributions::Mult("nue_nc_multkp", filt_nue_nc, 321),
-    new distributions::Mult("nue_nc_multkm", filt_nue_nc, -321),
-    new distributions::Mult("nue_nc_multk0", filt_nue_nc, 311)
+  std::vector<std::string> filename;
+  std::vector<std::string> labels;  // Samples: "" unless given with -l
+  std::vector<size_t> filesample;  // Sample of each input
+  size_t nthreads = std::thread::hardware_concurrency();
+  bool useindex = false;
+  bool usezones = false;
+  bool render = false;
+  size_t nuniverses = 0;
+  std::vector<std::string> weightsets;
+  size_t nreplicas = 0;
+  std::unique_ptr<Slicer> slicer;
+  std::string cachedir;
+  for (int i=2; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i+1 < argc) {
+      nthreads = std::atoi(argv[++i]);
+    }
+    else if (arg == "-i") {
+      useindex = true;
+    }
+    else if (arg == "-z") {
+      usezones = true;
+    }
+    else if (arg == "-p") {
+      render = true;
+    }
+    else if (arg == "-u" && i+1 < argc) {
+      nuniverses = std::atoi(argv[++i]);
+    }
+    else if (arg == "-s" && i+1 < argc) {
+      slicer.reset(Slicer::Parse(argv[++i]));
+      if (!slicer) {
+        std::cout << "Error: bad slicing " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "-b" && i+1 < argc) {
+      nreplicas = std::atoi(argv[++i]);
+    }
+    else if (arg == "-w" && i+1 < argc) {
+      std::stringstream sets(argv[++i]);
+      std::string set;
+      while (getline(sets, set, ',')) {
+        std::vector<float NuisTree::*> terms;
+        if (!EventWeights::ParseSet(set, terms)) {
+          std::cout << "Error: bad weight set " << set << std::endl;
+          return 1;
+        }
+        weightsets.push_back(set);
+      }
+    }
+    else if (arg == "-c" && i+1 < argc) {
+      cachedir = argv[++i];
+    }
+    else if (arg == "-l" && i+1 < argc) {
+      std::string label = argv[++i];
+      if (label.empty() || label.find_first_of("/:") != std::string::npos ||
+          std::find(labels.begin(), labels.end(), label) != labels.end()) {
+        std::cout << "Error: bad or repeated sample label " << label << std::endl;
+        return 1;
+      }
+      labels.push_back(label);
+    }
+    else if (arg == "-f" && i+1 < argc) {
+      std::ifstream inputlist(argv[++i]);
+      std::string line;
+      while (getline(inputlist, line)) {
+        std::cout << "FILE " << line << std::endl;
+        if (labels.empty()) labels.push_back("");
+        filename.push_back(line);
+        filesample.push_back(labels.size() - 1);
+      }
+    }
+    else {
+      std::cout << "FILE " << arg << std::endl;
+      if (labels.empty()) labels.push_back("");
+      filename.push_back(arg);
+      filesample.push_back(labels.size() - 1);
+    }
+  }
+
+  if (labels.size() > 1 && labels[0].empty()) {
+    std::cout << "Error: inputs before the first -l need a label" << std::endl;
+    return 1;
+  }
+  if (labels.empty()) {
+    labels.push_back("");
+  }
+
+  // Position of each input within its sample, which keys the bootstrap so
+  // that a sample's replicas do not depend on the other samples
+  std::vector<size_t> fileinsample(filename.size());
+  std::vector<size_t> nsamplefiles(labels.size(), 0);
+  for (size_t i=0; i<filename.size(); i++) {
+    fileinsample[i] = nsamplefiles[filesample[i]]++;
+  }
+
+  // Histograms are per-thread and merged at the end, so keep them out of
+  // gDirectory (which is shared, and would see the same names many times)
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(false);
+
+  Scheduler scheduler(nthreads);
+
+  // One full set of distributions per sample, per worker thread, each thread
+  // with its own buffer of channel weights for the current event. A
+  // thread's sets are kept one after another, so sample s fills
+  // dists[thread][s*ndists ... (s+1)*ndists-1].
+  std::vector<std::vector<Distribution*> > dists(scheduler.nthreads);
+  std::vector<EventWeights> weights(scheduler.nthreads, EventWeights(nuniverses, weightsets, nreplicas, slicer.get()));
+  size_t ndists = 0;
+  for (size_t i=0; i<scheduler.nthreads; i++) {
+    for (size_t s=0; s<labels.size(); s++) {
+      std::vector<Distribution*> set = MakeDistributions();
+      ndists = set.size();
+      dists[i].insert(dists[i].end(), set.begin(), set.end());
+    }
+    if (weights[i].size() > 0) {
+      for (Distribution* dist : dists[i]) {
+        dist->EnableChannels(&weights[i]);
+      }
+    }
+  }
+
+  // Distinct filters, so each is evaluated once per event, and the filter
+  // of each distribution (the same in every set, so those of each thread's
+  // first set are used for all samples)
+  std::vector<std::vector<Filter*> > filters(scheduler.nthreads);
+  std::vector<size_t> distfilter;
+  for (size_t i=0; i<scheduler.nthreads; i++) {
+    for (size_t j=0; j<ndists; j++) {
+      Filter* filter = dists[i][j]->filter;
+      auto it = std::find(filters[i].begin(), filters[i].end(), filter);
+      if (it == filters[i].end()) {
+        it = filters[i].insert(it, filter);
+      }
+      if (i == 0) {
+        distfilter.push_back(it - filters[i].begin());
+      }
+    }
+  }
+
+  // Each thread's bin sums go in one block, grouped by sample and filter so
+  // that the distributions filled together for an event are adjacent
+  std::vector<size_t> order(dists[0].size());
+  for (size_t j=0; j<order.size(); j++) order[j] = j;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (a / ndists != b / ndists) return a / ndists < b / ndists;
+    return distfilter[a % ndists] < distfilter[b % ndists];
+  });
+  std::vector<std::unique_ptr<BinArena> > arenas;
+  for (size_t i=0; i<scheduler.nthreads; i++) {
+    std::vector<Distribution*> ordered;
+    for (size_t j : order) ordered.push_back(dists[i][j]);
+    arenas.emplace_back(new BinArena);
+    arenas[i]->Attach(ordered);
+  }
+  std::cout << "ARENA " << arenas[0]->GetSize() / 1024 << " kB per thread" << std::endl;
+
+  if (useindex) {
+    for (Filter* filter : filters[0]) {
+      if (filter->Key().empty()) {
+        std::cout << "Warning: filter " << filter->title << " cannot be indexed, reading all entries" << std::endl;
+        useindex = false;
+        break;
+      }
+    }
+  }
+
+  // Samples with stored results are not read again. The key covers the
+  // options that change the histograms (not -i, -z or -j).
+  std::unique_ptr<ResultCache> cache;
+  std::vector<std::string> keys(labels.size());
+  std::vector<char> cached(labels.size(), false);
+  if (!cachedir.empty()) {
+    std::ostringstream options;
+    options << "u " << nuniverses << " b " << nreplicas << " w";
+    for (const std::string& set : weightsets) options << " " << set;
+    if (slicer) {
+      options << " s " << slicer->variable;
+      for (double value : slicer->values) options << " " << value;
+    }
+    cache.reset(new ResultCache(cachedir, std::vector<Distribution*>(dists[0].begin(), dists[0].begin() + ndists), options.str()));
+
+    for (size_t s=0; s<labels.size(); s++) {
+      std::vector<std::string> inputs;
+      for (size_t i=0; i<filename.size(); i++) {
+        if (filesample[i] == s) inputs.push_back(filename[i]);
+      }
+      keys[s] = cache->Key(inputs);
+      cached[s] = cache->Has(keys[s]);
+      std::cout << "CACHE " << (labels[s].empty() ? outfile : labels[s]) << " " << keys[s]
+                << (cached[s] ? " hit" : " miss") << std::endl;
+    }
+  }
+
+  // Split every input into tasks along its cluster boundaries. Event stores
+  // (see make_eventstore) are loaded up front and shared by all threads.
+  // Inputs with zone maps or complete entry lists only get the clusters
+  // that can hold passing entries.
+  std::vector<std::unique_ptr<EventStore> > stores(filename.size());
+  std::vector<std::unique_ptr<EntryIndex> > indexes(filename.size());
+  std::vector<std::unique_ptr<ZoneMap> > zonemaps(filename.size());
+  for (size_t i=0; i<filename.size(); i++) {
+    if (cached[filesample[i]]) {
+      continue;
+    }
+    if (EventStore::IsEventStore(filename[i])) {
+      if (nuniverses > 0) {
+        std::cout << "Error: event stores do not hold CustomWeightArray, needed for -u" << std::endl;
+        return 1;
+      }
+      stores[i].reset(new EventStore(filename[i]));
+      std::vector<std::pair<Long64_t, Long64_t> > chunks;
+      for (Long64_t first=0; first<stores[i]->GetEntries(); first+=100000) {
+        chunks.push_back(std::make_pair(first, std::min<Long64_t>(first+100000, stores[i]->GetEntries())));
+      }
+      scheduler.AddClusters(i, chunks);
+      continue;
+    }
+
+    TFile fin(filename[i].c_str(), "READ");
+    TTree *intree = (TTree*)fin.Get("GenericVectors__VARS");
+    if (!intree) {
+      std::cout << "Error: no GenericVectors__VARS tree in " << filename[i] << std::endl;
+      return 1;
+    }
+    if (nuniverses > 0) {
+      // Universes past the array's length would read stale buffer contents
+      int length = std::min(NuisTree::GetArrayLength(intree, "CustomWeightArray"), NuisTree::kMaxArray);
+      if ((int)nuniverses > length) {
+        std::cout << "Error: -u " << nuniverses << " but CustomWeightArray in " << filename[i]
+                  << " holds " << length << " universes" << std::endl;
+        return 1;
+      }
+    }
+    std::vector<std::pair<Long64_t, Long64_t> > clusters = NuisTree::GetClusters(intree);
+    if (usezones || fin.Get("buckets")) {
+      zonemaps[i].reset(new ZoneMap(filename[i]));
+      if (zonemaps[i]->IsComplete()) {
+        clusters = zonemaps[i]->Restrict(clusters, filters[0]);
+      }
+    }
+    if (useindex) {
+      indexes[i].reset(new EntryIndex(filename[i], filters[0]));
+      if (indexes[i]->IsComplete()) {
+        clusters = indexes[i]->Restrict(clusters);
+      }
+    }
+    scheduler.AddClusters(i, clusters);
+  }
+
+  // Each worker keeps its current input open until it is handed a task
+  // from a different file
+  struct Input {
+    size_t file;
+    std::unique_ptr<TFile> fin;
+    std::unique_ptr<NuisTree> nuistr;
   };
+  std::vector<Input> inputs(scheduler.nthreads);
+  std::mutex iomutex;
 
-  size_t nevents = 0;
+  auto close = [&](Input& input) {
+    if (!input.nuistr) return;
+    std::lock_guard<std::mutex> lock(iomutex);
+    input.nuistr->PrintCacheStats();
+    input.nuistr.reset();
+    input.fin.reset();
+  };
 
   // Event loop
-  for (int ievent=0; ievent<nuistr.GetEntries(); ievent++) {
-    if (ievent % 10000 == 0) {
-      std::cout << "EVENT " << ievent << std::endl;
+  scheduler.Run([&](size_t thread, const Task& task) {
+    Input& input = inputs[thread];
+    const EventStore* store = stores[task.file].get();
+    if (!input.nuistr || input.file != task.file) {
+      close(input);
+      input.file = task.file;
+      if (store) {
+        input.nuistr.reset(new NuisTree());
+      }
+      else {
+        input.fin.reset(new TFile(filename[task.file].c_str(), "READ"));
+        input.nuistr.reset(new NuisTree((TTree*)input.fin->Get("GenericVectors__VARS")));
+
+        // Only read what the filters and distributions use: the vertex stack is unused (see IMult) and CustomWeightArray is by far the largest branch
+        input.nuistr->DisableBranch("nvertp");
+        input.nuistr->DisableBranch("*_vert");
+        if (nuniverses == 0) {
+          input.nuistr->DisableBranch("CustomWeightArray");
+        }
+        input.nuistr->SetupCache();
+      }
     }
-    nuistr.GetEntry(ievent);
 
-    for (Distribution* dist : dists) {
-      if ((*dist->filter)(nuistr)) {
-        dist->Fill(nuistr);
+    // With complete entry lists, visit only the listed entries; otherwise
+    // record the passing entries if the input is being indexed
+    EntryIndex* index = indexes[task.file].get();
+    const std::vector<Long64_t>* listed = (index && index->IsComplete()) ? &index->GetEntries() : nullptr;
+    size_t ilisted = listed ? std::lower_bound(listed->begin(), listed->end(), task.first) - listed->begin() : 0;
+    std::vector<std::vector<Long64_t> > passed((index && !listed) ? filters[thread].size() : 0);
+    std::vector<char> pass(filters[thread].size());
+
+    // Summarize the task's entries if the input has no zone map yet. This
+    // needs every entry, so not when only listed entries are read.
+    ZoneMap* zonemap = zonemaps[task.file].get();
+    bool addzone = zonemap && !zonemap->IsComplete() && !listed;
+    Zone zone(task.first, task.last);
+
+    NuisTree& nuistr = *input.nuistr;
+    for (Long64_t ievent=task.first; ievent<task.last; ievent++) {
+      if (listed) {
+        if (ilisted == listed->size() || (*listed)[ilisted] >= task.last) break;
+        ievent = (*listed)[ilisted++];
+      }
+      if (ievent % 10000 == 0) {
+        std::lock_guard<std::mutex> lock(iomutex);
+        std::cout << "EVENT " << ievent << " FILE " << task.file << std::endl;
+      }
+      if (store) {
+        store->GetEntry(ievent, nuistr);
+      }
+      else {
+        nuistr.GetEntry(ievent);
+      }
+
+      if (addzone) {
+        zone.Add(nuistr);
+      }
+
+      bool any = false;
+      for (size_t k=0; k<filters[thread].size(); k++) {
+        pass[k] = (*filters[thread][k])(nuistr);
+        any = any || pass[k];
+        if (pass[k] && !passed.empty()) {
+          passed[k].push_back(ievent);
+        }
+      }
+
+      // Channel weights are the same for every distribution. The bootstrap
+      // is keyed on the file (within its sample) and entry, not on the thread.
+      if (any && weights[thread].size() > 0) {
+        weights[thread].Set(nuistr, ((uint64_t)fileinsample[task.file] << 40) + ievent);
+      }
+
+      Distribution** sampledists = &dists[thread][filesample[task.file] * ndists];
+      for (size_t j=0; j<ndists; j++) {
+        if (pass[distfilter[j]]) {
+          sampledists[j]->Fill(nuistr);
+        }
       }
     }
-  } // end event loop
 
-  // Save histograms (to file and png)
-  TFile* fout = new TFile(outfile.c_str(), "recreate");
-  for (Distribution* dist : dists) {
-    if (dist->hist->GetEntries() > 0) {
-      dist->Write();
-      // dist->Save();
+    if (!passed.empty()) {
+      index->Add(passed);
+    }
+    if (addzone) {
+      zonemap->Add(zone);
     }
+  }); // end event loop
+
+  for (Input& input : inputs) {
+    close(input);
+  }
+
+  // Save entry lists and zone maps made on this pass
+  for (size_t i=0; i<filename.size(); i++) {
+    bool listed = indexes[i] && indexes[i]->IsComplete();
+    if (indexes[i] && !listed) {
+      indexes[i]->Write();
+    }
+    if (zonemaps[i] && !zonemaps[i]->IsComplete() && !listed) {
+      zonemaps[i]->Write();
+    }
+  }
+
+  // Merge the per-thread histograms into the first set
+  for (size_t i=1; i<dists.size(); i++) {
+    arenas[0]->Merge(*arenas[i]);
+    for (size_t j=0; j<dists[0].size(); j++) {
+      dists[0][j]->Merge(*dists[i][j]);
+    }
+  }
+
+  // Save histograms (to file and png), each sample in its own directory,
+  // then store the new results and copy in the stored ones
+  std::vector<Distribution*> written;
+  std::vector<std::string> dirnames;
+  for (size_t j=0; j<dists[0].size(); j++) {
+    if (!cached[j / ndists]) {
+      written.push_back(dists[0][j]);
+      dirnames.push_back(labels[j / ndists]);
+    }
+  }
+  WriteDistributions(written, dirnames, outfile, scheduler.nthreads);
+
+  if (cache) {
+    TFile fout(outfile.c_str(), "UPDATE");
+    for (size_t s=0; s<labels.size(); s++) {
+      if (!cached[s]) {
+        std::vector<Distribution*> sample(dists[0].begin() + s * ndists, dists[0].begin() + (s + 1) * ndists);
+        cache->Store(keys[s], sample, scheduler.nthreads);
+        continue;
+      }
+      TDirectory* dir = &fout;
+      if (!labels[s].empty()) {
+        dir = fout.GetDirectory(labels[s].c_str());
+        dir = dir ? dir : fout.mkdir(labels[s].c_str());
+      }
+      if (!cache->Load(keys[s], dir)) {
+        std::cout << "Error: cannot read stored results " << keys[s] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // PNG names do not tell samples apart, so only single samples are rendered
+  if (render && labels.size() > 1) {
+    std::cout << "Warning: -p renders a single sample; use compare on " << outfile << std::endl;
+  }
+  else if (render && cached[0]) {
+    std::cout << "Warning: -p does not render stored results" << std::endl;
+  }
+  else if (render) {
+    SaveDistributions(dists[0], scheduler.nthreads);
   }
-  fout->Close();
 
   return 0;
 }
@@ -0,0 +1,23 @@
+#ifndef __PLOTSET__
+#define __PLOTSET__
+
+/**
+ * The set of filters and distributions made by the plotters.
+ *
+ * Shared by plot_kinematics and plot_kinematics_nuistr, so both produce
+ * the same plots with the same names.
+ */
+
+#include <vector>
+
+struct Distribution;
+
+/**
+ * Build a fresh set of filters and distributions.
+ *
+ * Each call allocates new histograms, so worker threads can each fill
+ * their own set and merge them at the end.
+ */
+std::vector<Distribution*> MakeDistributions();
+
+#endif  // __PLOTSET__
@@ -1,6 +1,6 @@
 # Script to make GENIE validation plots and upload to https://microboone-sim.fnal.gov/
 # Takes as input:
-# - up to 5 input NUISANCE GenericVectors tree files (can be extended if desired -- will also require editing compare.py to accept more than 5 inputs)
+# - two or more input NUISANCE GenericVectors tree files
 # - a "legend title" for each of those input files (to be used in plot legends and the webpage organisation)
 #
 # Example usage:
@@ -16,8 +16,9 @@ import websitehelper
 
 # Parse arguments
 parser = argparse.ArgumentParser(description='Create and upload a set of validation plots to the https://microboone-sim.fnal.gov website')
-parser.add_argument('inputs',nargs='*',help='Input files and legend titles, in the format "input1.root legendtitle1.root input2.root legendtitle2 [input3.root legendtitle3 input4.root legendtitle4 input5.root legendtitle5]". You must provide a legend title corresponding to every input file. You must provide at least two input files with legend titles.')
+parser.add_argument('inputs',nargs='*',help='Input files and legend titles, in the format "input1.root legendtitle1.root input2.root legendtitle2 [input3.root legendtitle3 ...]". You must provide a legend title corresponding to every input file. You must provide at least two input files with legend titles.')
 parser.add_argument('-norm','--normalize',action='store_true',help='Plot area-normalized distributions (rather than absolutely normalized)')
+parser.add_argument('-c','--cache',default='plotcache',help='Directory of stored histograms, reused for inputs that have not changed (default: plotcache)')
 parser.add_argument('-f','--force',action='store_true',help='Use to force creation of plot directories when that will involve overwriting existing plots. Use with care!')
 args = parser.parse_args()
 
@@ -39,27 +40,27 @@ assert len(input_rootfiles)*2 == len(args.inputs), "Input root files: %s, All in
 #                  Stage 1: Make the plots                        #
 ###################################################################
 
-# Build the app to make the plots
-os.system('make plot_kinematics_nuistr')
+# Build the apps to make the plots and the overlays
+os.system('make plot_kinematics_nuistr compare')
 
-# Make histograms for each individual thing we want to compare
+# Make histograms for all the inputs in one pass, each in its own directory
+# (sample0, sample1, ...) of one file. Samples that have not changed since
+# the last run are taken from the result cache.
+cmd = './plot_kinematics_nuistr samples.root -c ' + args.cache
 for i in range(len(input_rootfiles)):
-    cmd = './plot_kinematics_nuistr tmpfile_%d.root '%i +input_rootfiles[i]
-    os.system(cmd)
-
-# The command above made a lot of .png output files that we don't want to keep - delete them to stop filling up directories
-os.system('rm *.png')
+    cmd += ' -l sample%d '%i + input_rootfiles[i]
+os.system(cmd)
 
-# Now run compare.py to produce overlay plots
-cmd = 'python compare.py '+str(args.normalize)
+# Now run compare to produce overlay plots
+cmd = './compare'
+if args.normalize:
+    cmd += ' -n'
 for i in range(len(input_rootfiles)):
-    cmd += ' tmpfile_%d.root '%i + '"'+input_legendtitles[i]+'"'
+    cmd += ' samples.root:sample%d '%i + '"'+input_legendtitles[i]+'"'
 os.system(cmd)
 
-# Clean up by deleting the .root files we made
-for i in range(len(input_rootfiles)):
-    cmd = 'rm tmpfile_%d.root'%i
-    os.system(cmd)
+# Clean up by deleting the .root file we made
+os.system('rm samples.root')
 
 ###################################################################
 #                Stage 2: Upload to the webpage                   #
@@ -0,0 +1,215 @@
+/**
+ * Make histograms from an ntuple written by make_ntuple.
+ *
+ * Each histogram is given as COLUMN:NBINS:MIN:MAX, or for 2D as
+ * XCOLUMN:NBINS:MIN:MAX,YCOLUMN:NBINS:MIN:MAX. Only the columns used are
+ * read, and all histograms are filled in one pass, weighted by the event
+ * weight. With -k, each histogram is made once per filter key, from the
+ * events passing that filter; otherwise from all events.
+ *
+ * Histograms are named "h_COLUMN" (2D: "h_XCOLUMN_YCOLUMN"), with "_KEY"
+ * appended per filter.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TNamed.h"
+#include "TTree.h"
+
+namespace {
+
+  // One axis of a histogram specification
+  struct Axis {
+    std::string column;
+    int nbins;
+    double min;
+    double max;
+  };
+
+  // Parse COLUMN:NBINS:MIN:MAX
+  bool ParseAxis(const std::string& spec, Axis& axis) {
+    std::stringstream ss(spec);
+    std::string nbins, min, max;
+    if (!std::getline(ss, axis.column, ':') || !std::getline(ss, nbins, ':') ||
+        !std::getline(ss, min, ':') || !std::getline(ss, max)) {
+      return false;
+    }
+    axis.nbins = std::atoi(nbins.c_str());
+    axis.min = std::atof(min.c_str());
+    axis.max = std::atof(max.c_str());
+    return !axis.column.empty() && axis.nbins > 0 && axis.max > axis.min;
+  }
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  std::vector<std::string> keys;
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-k" && i+1 < argc) {
+      keys.push_back(argv[++i]);
+    }
+    else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() < 3) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "[-k KEY ...] NTUPLE.root OUTPUT.root COLUMN:NBINS:MIN:MAX[,COLUMN:NBINS:MIN:MAX] ..." << std::endl
+              << "  -k  Fill from the events passing this filter (repeatable; keys are in the ntuple's \"filters\")" << std::endl;
+    return 0;
+  }
+
+  std::vector<std::vector<Axis> > specs;
+  for (size_t i=2; i<args.size(); i++) {
+    std::vector<Axis> axes;
+    std::stringstream ss(args[i]);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+      Axis axis;
+      if (!ParseAxis(part, axis)) {
+        std::cout << "Error: bad histogram " << args[i] << std::endl;
+        return 1;
+      }
+      axes.push_back(axis);
+    }
+    if (axes.empty() || axes.size() > 2) {
+      std::cout << "Error: bad histogram " << args[i] << std::endl;
+      return 1;
+    }
+    specs.push_back(axes);
+  }
+
+  TFile fin(args[0].c_str(), "READ");
+  TTree* ntuple = (TTree*)fin.Get("ntuple");
+  TNamed* filternames = (TNamed*)fin.Get("filters");
+  if (!ntuple || !filternames) {
+    std::cout << "Error: no ntuple in " << args[0] << std::endl;
+    return 1;
+  }
+
+  // Filter mask bit of each key
+  std::vector<std::string> filterkeys;
+  {
+    std::stringstream ss(filternames->GetTitle());
+    std::string key;
+    while (std::getline(ss, key, ',')) {
+      filterkeys.push_back(key);
+    }
+  }
+  std::vector<ULong64_t> bits;
+  for (const std::string& key : keys) {
+    auto it = std::find(filterkeys.begin(), filterkeys.end(), key);
+    if (it == filterkeys.end()) {
+      std::cout << "Error: no filter " << key << " in " << args[0] << std::endl;
+      return 1;
+    }
+    bits.push_back(1ULL << (it - filterkeys.begin()));
+  }
+  if (keys.empty()) {
+    keys.push_back("");
+    bits.push_back(~0ULL);
+  }
+
+  // Read only the columns used
+  ULong64_t mask;
+  float weight;
+  std::map<std::string, float> values;
+  ntuple->SetBranchStatus("*", 0);
+  ntuple->SetBranchStatus("filters", 1);
+  ntuple->SetBranchStatus("Weight", 1);
+  ntuple->SetBranchAddress("filters", &mask);
+  ntuple->SetBranchAddress("Weight", &weight);
+  for (const auto& axes : specs) {
+    for (const Axis& axis : axes) {
+      if (!ntuple->GetBranch(axis.column.c_str())) {
+        std::cout << "Error: no column " << axis.column << " in " << args[0] << std::endl;
+        return 1;
+      }
+      values[axis.column] = 0;
+    }
+  }
+  for (auto& value : values) {
+    ntuple->SetBranchStatus(value.first.c_str(), 1);
+    ntuple->SetBranchAddress(value.first.c_str(), &value.second);
+  }
+
+  // One histogram per specification and key, [spec][key]
+  TFile fout(args[1].c_str(), "RECREATE");
+  std::vector<std::vector<TH1*> > hists(specs.size());
+  std::vector<std::vector<const float*> > xy(specs.size());
+  for (size_t i=0; i<specs.size(); i++) {
+    const std::vector<Axis>& axes = specs[i];
+    std::string name = "h_" + axes[0].column + (axes.size() == 2 ? "_" + axes[1].column : "");
+    for (const Axis& axis : axes) {
+      xy[i].push_back(&values[axis.column]);
+    }
+    for (const std::string& key : keys) {
+      std::string hname = name + (key.empty() ? "" : "_" + key);
+      TH1* h;
+      if (axes.size() == 2) {
+        h = new TH2F(hname.c_str(), (";" + axes[0].column + ";" + axes[1].column).c_str(),
+                     axes[0].nbins, axes[0].min, axes[0].max,
+                     axes[1].nbins, axes[1].min, axes[1].max);
+      }
+      else {
+        h = new TH1F(hname.c_str(), (";" + axes[0].column).c_str(),
+                     axes[0].nbins, axes[0].min, axes[0].max);
+      }
+      hists[i].push_back(h);
+    }
+  }
+
+  // Event loop. Columns not computed for an event (NaN) are skipped.
+  Long64_t nentries = ntuple->GetEntries();
+  for (Long64_t ievent=0; ievent<nentries; ievent++) {
+    if (ievent % 1000000 == 0) {
+      std::cout << "EVENT " << ievent << std::endl;
+    }
+    ntuple->GetEntry(ievent);
+    for (size_t i=0; i<specs.size(); i++) {
+      float x = *xy[i][0];
+      if (std::isnan(x)) continue;
+      if (xy[i].size() == 2) {
+        float y = *xy[i][1];
+        if (std::isnan(y)) continue;
+        for (size_t k=0; k<bits.size(); k++) {
+          if (mask & bits[k]) {
+            ((TH2F*)hists[i][k])->Fill(x, y, weight);
+          }
+        }
+      }
+      else {
+        for (size_t k=0; k<bits.size(); k++) {
+          if (mask & bits[k]) {
+            hists[i][k]->Fill(x, weight);
+          }
+        }
+      }
+    }
+  }
+
+  for (const auto& hs : hists) {
+    for (TH1* h : hs) {
+      std::cout << "WRITE " << h->GetName() << std::endl;
+      h->Write();
+    }
+  }
+  fout.Close();
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * Reorder NUISANCE GenericVectors__VARS trees by event class.
+ *
+ * Events are grouped into buckets of one (PDGnu, cc, GENIE mode), keeping
+ * their original order within a bucket, and the buckets are written one
+ * after another, each starting a new TTree cluster. A "buckets" tree in the
+ * output gives each bucket's entry range and zone summary (see zonemap.h),
+ * so plot_kinematics_nuistr reads only the buckets its filters can pass, as
+ * sequential ranges. Similar events sitting together also compress better.
+ *
+ * The inputs are swept once per bucket, reading only the baskets that hold
+ * the bucket's events, so this is meant to be run once per sample.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "NuisTree.h"
+#include "zonemap.h"
+
+int main(int argc, char* argv[]) {
+  // Parse command-line arguments
+  if (argc < 3) {
+    std::cout << "Usage: " << argv[0] << " "
+              << "OUTPUT.root INPUT.root [INPUT2.root ...]" << std::endl;
+    return 0;
+  }
+
+  TChain chain("GenericVectors__VARS");
+  for (int i=2; i<argc; i++) {
+    std::cout << "FILE " << argv[i] << std::endl;
+    chain.Add(argv[i]);
+  }
+
+  // First pass: bucket every entry, reading only the bucket keys
+  typedef std::tuple<int, int, int> Key;  // PDGnu, cc, GENIE mode
+  std::map<Key, std::vector<Long64_t> > buckets;
+  {
+    int pdgnu, mode;
+    Char_t cc;
+    chain.SetBranchStatus("*", 0);
+    chain.SetBranchStatus("PDGnu", 1);
+    chain.SetBranchStatus("cc", 1);
+    chain.SetBranchStatus("Mode", 1);
+    chain.SetBranchAddress("PDGnu", &pdgnu);
+    chain.SetBranchAddress("cc", &cc);
+    chain.SetBranchAddress("Mode", &mode);
+
+    Long64_t nentries = chain.GetEntries();
+    for (Long64_t ievent=0; ievent<nentries; ievent++) {
+      if (ievent % 100000 == 0) {
+        std::cout << "EVENT " << ievent << std::endl;
+      }
+      chain.GetEntry(ievent);
+      Key key(pdgnu, (bool)cc, NuisTree::GetGENIEMode(mode));
+      buckets[key].push_back(ievent);
+    }
+    chain.SetBranchStatus("*", 1);
+  }
+
+  // Second pass: copy the buckets in order
+  TFile fout(argv[1], "RECREATE");
+  NuisTree nuistr(&chain);
+  TTree* outtree = chain.CloneTree(0);
+
+  std::vector<Zone> zones;
+  Long64_t nwritten = 0;
+  for (const auto& bucket : buckets) {
+    Zone zone(nwritten, nwritten + bucket.second.size());
+    for (Long64_t ievent : bucket.second) {
+      chain.GetEntry(ievent);
+      zone.Add(nuistr);
+      outtree->Fill();
+    }
+    outtree->FlushBaskets();
+    nwritten = zone.last;
+    zones.push_back(zone);
+
+    std::cout << "BUCKET PDGnu " << std::get<0>(bucket.first)
+              << " cc " << std::get<1>(bucket.first)
+              << " mode " << std::get<2>(bucket.first)
+              << ": " << bucket.second.size() << " entries" << std::endl;
+  }
+
+  outtree->Write();
+  ZoneMap::WriteZones(zones, "buckets", "Bucket entry ranges");
+  fout.Close();
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <typeinfo>
+#include <vector>
+#include <sys/stat.h>
+#include "RVersion.h"
+#include "TAxis.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TSystem.h"
+#include "TUUID.h"
+#include "distributions.h"
+#include "eventstore.h"
+#include "filter.h"
+#include "output.h"
+#include "resultcache.h"
+
+namespace {
+
+  // 64-bit FNV-1a, continued from h
+  uint64_t Hash(const char* data, size_t n, uint64_t h=14695981039346656037ULL) {
+    for (size_t i=0; i<n; i++) {
+      h ^= (unsigned char)data[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  uint64_t Hash(const std::string& s, uint64_t h=14695981039346656037ULL) {
+    return Hash(s.data(), s.size(), h);
+  }
+
+  std::string Hex(uint64_t h) {
+    char s[17];
+    snprintf(s, sizeof(s), "%016llx", (unsigned long long)h);
+    return s;
+  }
+
+  // The ROOT release and the running executable, so that any rebuild
+  // changes the keys. Where the executable cannot be read, fall back to the
+  // build time of this file.
+  uint64_t HashBinary() {
+    uint64_t h = Hash(std::string(ROOT_RELEASE));
+    std::ifstream exe("/proc/self/exe", std::ios::binary);
+    if (!exe) {
+      return Hash(std::string(__DATE__ " " __TIME__), h);
+    }
+    std::vector<char> buffer(1 << 20);
+    while (exe.read(buffer.data(), buffer.size()) || exe.gcount() > 0) {
+      h = Hash(buffer.data(), exe.gcount(), h);
+    }
+    return h;
+  }
+
+  void DescribeAxis(std::ostream& out, const TAxis* axis) {
+    out << " " << axis->GetNbins();
+    for (int i=1; i<=axis->GetNbins()+1; i++) {
+      out << " " << axis->GetBinLowEdge(i);
+    }
+  }
+
+  void Describe(std::ostream& out, const Distribution* dist) {
+    out << typeid(*dist).name() << " " << dist->name << " " << dist->title;
+    if (dist->filter) {
+      std::string key = dist->filter->Key();
+      out << " | " << (key.empty() ? dist->filter->title : key);
+    }
+    const TH1* hist = dist->hist;
+    out << " | " << hist->GetDimension();
+    DescribeAxis(out, hist->GetXaxis());
+    if (hist->GetDimension() > 1) {
+      DescribeAxis(out, hist->GetYaxis());
+    }
+    out << "\n";
+  }
+
+}  // namespace
+
+
+ResultCache::ResultCache(const std::string& _dir, const std::vector<Distribution*>& dists,
+                         const std::string& options)
+    : dir(_dir) {
+  gSystem->mkdir(dir.c_str(), true);
+
+  std::ostringstream desc;
+  desc.precision(17);
+  desc << options << "\n";
+  for (const Distribution* dist : dists) {
+    const distributions::MultGroup* group = dynamic_cast<const distributions::MultGroup*>(dist);
+    if (group) {
+      for (const Distribution* mult : group->mults) {
+        Describe(desc, mult);
+      }
+    }
+    else {
+      Describe(desc, dist);
+    }
+  }
+  config = Hex(Hash(desc.str(), HashBinary()));
+}
+
+
+std::string ResultCache::Key(const std::vector<std::string>& filenames) const {
+  // Inputs are identified by content, not path, so moved files still match
+  uint64_t h = Hash(config);
+  for (const std::string& filename : filenames) {
+    std::string uuid;
+    if (!EventStore::IsEventStore(filename)) {
+      TFile fin(filename.c_str(), "READ");
+      uuid = fin.GetUUID().AsString();
+    }
+    struct stat st;
+    long long size = -1, mtime = -1;
+    if (stat(filename.c_str(), &st) == 0) {
+      size = st.st_size;
+      mtime = st.st_mtime;
+    }
+    std::ostringstream id;
+    id << uuid << " " << size << " " << mtime << "\n";
+    h = Hash(id.str(), h);
+  }
+  return Hex(h);
+}
+
+
+std::string ResultCache::Path(const std::string& key) const {
+  return dir + "/" + key + ".root";
+}
+
+
+bool ResultCache::Has(const std::string& key) const {
+  if (!std::ifstream(Path(key))) {
+    return false;
+  }
+  std::unique_ptr<TFile> f(TFile::Open(Path(key).c_str(), "READ"));
+  return f && !f->IsZombie();
+}
+
+
+bool ResultCache::Load(const std::string& key, TDirectory* out) const {
+  std::unique_ptr<TFile> f(TFile::Open(Path(key).c_str(), "READ"));
+  if (!f || f->IsZombie()) {
+    return false;
+  }
+
+  // Keys are in decreasing cycle order, so keep the first of each name
+  std::set<std::string> copied;
+  TIter next(f->GetListOfKeys());
+  while (TKey* k = (TKey*)next()) {
+    if (!copied.insert(k->GetName()).second) {
+      continue;
+    }
+    std::unique_ptr<TObject> obj(k->ReadObj());
+    out->WriteTObject(obj.get(), k->GetName());
+  }
+  return true;
+}
+
+
+void ResultCache::Store(const std::string& key, const std::vector<Distribution*>& dists,
+                        size_t nthreads) const {
+  std::string path = Path(key);
+  std::string tmp = path + ".tmp";
+  WriteDistributions(dists, tmp, nthreads);
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::cout << "Warning: cannot store results in " << path << std::endl;
+    std::remove(tmp.c_str());
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef __RESULTCACHE__
+#define __RESULTCACHE__
+
+/**
+ * A local cache of plotter results, addressed by content.
+ *
+ * Regenerating a set of comparisons usually changes one sample, while the
+ * baseline samples have not changed in months. The histograms written for
+ * a sample are kept in a cache directory, in a file named by a hash of
+ * everything they depend on: the identity of each input (ROOT UUID, size
+ * and modification time), the distributions and filters (names, binnings,
+ * filter keys) and the weight options, and the plotter binary and ROOT
+ * release. A later run with the same key copies the stored histograms
+ * instead of reading the sample's inputs; any change gives a new key, so
+ * entries are never stale, only unused.
+ */
+
+#include <string>
+#include <vector>
+
+struct Distribution;
+class TDirectory;
+
+/**
+ * \class ResultCache
+ * \brief Stored histograms of samples, by key.
+ *
+ * \param _dir Cache directory, made if needed
+ * \param dists The distributions of one sample
+ * \param options Other settings the histograms depend on (e.g. weights)
+ */
+class ResultCache {
+public:
+  ResultCache(const std::string& _dir, const std::vector<Distribution*>& dists,
+              const std::string& options);
+
+  /** Key of the results for a sample with the given inputs. */
+  std::string Key(const std::vector<std::string>& filenames) const;
+
+  /** True if results are stored for the key. */
+  bool Has(const std::string& key) const;
+
+  /**
+   * Copy the stored results into a directory.
+   *
+   * \returns False if there are none
+   */
+  bool Load(const std::string& key, TDirectory* out) const;
+
+  /**
+   * Store results (see WriteDistributions). The file is written under a
+   * temporary name and then renamed, so that an interrupted run leaves no
+   * partial entry.
+   *
+   * \param key The key
+   * \param dists The distributions of the sample
+   * \param nthreads Number of writer threads
+   */
+  void Store(const std::string& key, const std::vector<Distribution*>& dists,
+             size_t nthreads) const;
+
+private:
+  /** File holding the results for a key. */
+  std::string Path(const std::string& key) const;
+
+  std::string dir;  //!< Cache directory
+  std::string config;  //!< Hash of the configuration and binary
+};
+
+#endif  // __RESULTCACHE__
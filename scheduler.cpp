@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <thread>
+#include "scheduler.h"
+
+Scheduler::Scheduler(size_t _nthreads)
+    : nthreads(_nthreads > 0 ? _nthreads : 1) {
+  for (size_t i=0; i<nthreads; i++) {
+    queues.emplace_back(new Queue);
+  }
+}
+
+
+void Scheduler::Add(const Task& task) {
+  pending.push_back(task);
+}
+
+
+void Scheduler::AddClusters(size_t file,
+                            const std::vector<std::pair<long long, long long> >& clusters,
+                            long long mintask) {
+  Task task = { file, -1, -1 };
+  for (const auto& cluster : clusters) {
+    if (task.first < 0) {
+      task.first = cluster.first;
+    }
+    task.last = cluster.second;
+    if (task.last - task.first >= mintask) {
+      Add(task);
+      task.first = -1;
+    }
+  }
+  if (task.first >= 0) {
+    Add(task);
+  }
+}
+
+
+void Scheduler::Run(std::function<void(size_t, const Task&)> fn) {
+  // Deal out contiguous blocks with roughly equal numbers of entries. Whole
+  // file tasks have unknown size and count as one unit each.
+  long long total = 0;
+  for (const Task& task : pending) {
+    total += (task.last < 0 ? 1 : task.last - task.first);
+  }
+
+  long long done = 0;
+  for (const Task& task : pending) {
+    size_t q = total > 0 ? std::min<size_t>(nthreads * done / total, nthreads - 1) : 0;
+    queues[q]->tasks.push_back(task);
+    done += (task.last < 0 ? 1 : task.last - task.first);
+  }
+  pending.clear();
+
+  std::vector<std::thread> workers;
+  for (size_t i=0; i<nthreads; i++) {
+    workers.emplace_back([this, i, &fn]() {
+      Task task;
+      while (Next(i, task)) {
+        fn(i, task);
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+
+bool Scheduler::Next(size_t thread, Task& task) {
+  // Own work first, from the front
+  {
+    Queue& own = *queues[thread];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  // Steal from the back of the other workers' deques, so the victim keeps
+  // working through its own block in order. No new tasks are added while
+  // running, so once every deque is empty we are done.
+  for (size_t i=1; i<nthreads; i++) {
+    Queue& victim = *queues[(thread + i) % nthreads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,82 @@
+#ifndef __SCHEDULER__
+#define __SCHEDULER__
+
+/**
+ * Work-stealing scheduler for the event loop.
+ *
+ * Work is split into tasks, each covering a range of entries (typically a
+ * run of TTree clusters) in one input file. Each worker thread owns a deque
+ * of tasks: it takes work from the front of its own deque and, once that is
+ * empty, steals from the back of another worker's. A slow file, e.g. one
+ * dominated by DIS events with large final-state stacks, is therefore shared
+ * out instead of setting the wall-clock time of the whole run.
+ */
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * \struct Task
+ * \brief A range of entries [first, last) in one input file.
+ *
+ * A last entry of -1 stands for "to the end of the file", for inputs that
+ * cannot be split by entry.
+ */
+struct Task {
+  size_t file;  //!< Index of the input file
+  long long first;  //!< First entry
+  long long last;  //!< One past the last entry, or -1 for the whole file
+};
+
+
+/**
+ * \class Scheduler
+ * \brief Runs tasks on a pool of threads with work stealing.
+ *
+ * \param _nthreads Number of worker threads
+ */
+class Scheduler {
+public:
+  Scheduler(size_t _nthreads);
+
+  /** Queue a task. Tasks should be added in file/entry order. */
+  void Add(const Task& task);
+
+  /**
+   * Run fn(thread, task) for every queued task, blocking until all are done.
+   *
+   * Tasks are dealt out to the workers in contiguous blocks of roughly equal
+   * numbers of entries, so that a worker normally stays within one file.
+   */
+  void Run(std::function<void(size_t, const Task&)> fn);
+
+  /**
+   * Split each file's clusters into tasks of at least mintask entries.
+   *
+   * \param file Index of the input file
+   * \param clusters Entry ranges [first, last) of the file's clusters
+   * \param mintask Minimum number of entries per task
+   */
+  void AddClusters(size_t file,
+                   const std::vector<std::pair<long long, long long> >& clusters,
+                   long long mintask=10000);
+
+  size_t nthreads;  //!< Number of worker threads
+
+private:
+  /** Take the next task for a worker, stealing if its own deque is empty. */
+  bool Next(size_t thread, Task& task);
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<Task> pending;  //!< Tasks not yet dealt out
+  std::vector<std::unique_ptr<Queue> > queues;  //!< Per-worker deques
+};
+
+#endif  // __SCHEDULER__
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include "TH1.h"
+#include "THnSparse.h"
+#include "sparsehist.h"
+
+namespace {
+
+  const size_t kInitialSize = 1 << 12;
+
+  // Fibonacci hashing: the top bits of key * 2^64/phi
+  size_t Hash(uint64_t key, size_t mask) {
+    return (key * 0x9e3779b97f4a7c15ULL) >> 32 & mask;
+  }
+
+}  // namespace
+
+
+SparseHist::SparseHist(const std::vector<int>& _nbins, const std::vector<double>& _min,
+                       const std::vector<double>& _max)
+    : nbins(_nbins), min(_min), max(_max), stride(_nbins.size()),
+      cells(kInitialSize, Cell{0, 0, 0}), nfilled(0), nentries(0) {
+  if (min.size() != nbins.size() || max.size() != nbins.size()) {
+    throw std::invalid_argument("SparseHist: axis size mismatch");
+  }
+  uint64_t s = 1;
+  for (size_t a=0; a<nbins.size(); a++) {
+    stride[a] = s;
+    s *= nbins[a] + 2;
+  }
+}
+
+
+void SparseHist::Fill(const double* x, double w) {
+  uint64_t index = 0;
+  for (size_t a=0; a<nbins.size(); a++) {
+    int i;
+    if (!(x[a] >= min[a])) i = 0;
+    else if (x[a] >= max[a]) i = nbins[a] + 1;
+    else i = 1 + std::min(nbins[a] - 1, (int)((x[a] - min[a]) / (max[a] - min[a]) * nbins[a]));
+    index += i * stride[a];
+  }
+
+  Cell& cell = Find(index + 1);
+  cell.sumw += w;
+  cell.sumw2 += w * w;
+  nentries++;
+}
+
+
+SparseHist::Cell& SparseHist::Find(uint64_t key) {
+  size_t mask = cells.size() - 1;
+  size_t i = Hash(key, mask);
+  while (cells[i].key != key) {
+    if (cells[i].key == 0) {
+      // Keep the table at most half full, so probe runs stay short
+      if (2 * (nfilled + 1) > cells.size()) {
+        Grow();
+        return Find(key);
+      }
+      cells[i].key = key;
+      nfilled++;
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+  return cells[i];
+}
+
+
+void SparseHist::Grow() {
+  std::vector<Cell> old(2 * cells.size(), Cell{0, 0, 0});
+  old.swap(cells);
+  size_t mask = cells.size() - 1;
+  for (const Cell& cell : old) {
+    if (cell.key == 0) continue;
+    size_t i = Hash(cell.key, mask);
+    while (cells[i].key != 0) {
+      i = (i + 1) & mask;
+    }
+    cells[i] = cell;
+  }
+}
+
+
+void SparseHist::Merge(const SparseHist& other) {
+  for (const Cell& cell : other.cells) {
+    if (cell.key == 0) continue;
+    Cell& c = Find(cell.key);
+    c.sumw += cell.sumw;
+    c.sumw2 += cell.sumw2;
+  }
+  nentries += other.nentries;
+}
+
+
+void SparseHist::Reset() {
+  cells.assign(kInitialSize, Cell{0, 0, 0});
+  nfilled = 0;
+  nentries = 0;
+}
+
+
+double SparseHist::Coordinate(size_t axis, int i) const {
+  double width = (max[axis] - min[axis]) / nbins[axis];
+  if (i == 0) return min[axis] - width;
+  if (i == nbins[axis] + 1) return max[axis] + width;
+  return min[axis] + (i - 0.5) * width;
+}
+
+
+void SparseHist::Project(TH1* hist, const std::vector<int>& axes) const {
+  std::vector<double> sumw(hist->GetNcells(), 0);
+  std::vector<double> sumw2(hist->GetNcells(), 0);
+  for (const Cell& cell : cells) {
+    if (cell.key == 0) continue;
+    uint64_t index = cell.key - 1;
+    double x[2] = {0, 0};
+    for (size_t k=0; k<axes.size() && k<2; k++) {
+      int a = axes[k];
+      x[k] = Coordinate(a, index / stride[a] % (nbins[a] + 2));
+    }
+    int bin = hist->FindFixBin(x[0], x[1]);
+    sumw[bin] += cell.sumw;
+    sumw2[bin] += cell.sumw2;
+  }
+
+  hist->Reset();
+  for (size_t bin=0; bin<sumw.size(); bin++) {
+    hist->SetBinContent(bin, sumw[bin]);
+    hist->SetBinError(bin, std::sqrt(sumw2[bin]));
+  }
+  hist->SetEntries(nentries);
+}
+
+
+void SparseHist::Write(const std::string& name, const std::string& title) const {
+  THnSparseD h(name.c_str(), title.c_str(), nbins.size(), nbins.data(), min.data(), max.data());
+  h.Sumw2();
+  std::vector<Int_t> idx(nbins.size());
+  for (const Cell& cell : cells) {
+    if (cell.key == 0) continue;
+    uint64_t index = cell.key - 1;
+    for (size_t a=0; a<nbins.size(); a++) {
+      idx[a] = index / stride[a] % (nbins[a] + 2);
+    }
+    Long64_t bin = h.GetBin(idx.data());
+    h.SetBinContent(bin, cell.sumw);
+    h.SetBinError2(bin, cell.sumw2);
+  }
+  h.SetEntries(nentries);
+
+  std::cout << "WRITE " << name << " (" << nfilled << " cells)" << std::endl;
+  h.Write();
+}
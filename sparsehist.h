@@ -0,0 +1,93 @@
+#ifndef __SPARSEHIST__
+#define __SPARSEHIST__
+
+/**
+ * Sparse N-dimensional histograms.
+ *
+ * Fine binning in several variables at once (e.g. q0 x q3 x Enu at 5 MeV)
+ * would need hundreds of millions of dense bins per filter and thread, but
+ * only a small fraction of them are ever filled. A SparseHist keeps just the
+ * filled cells, in an open-addressing hash table: a fill hashes the global
+ * cell index and probes linearly through one flat array, so the common case
+ * (a cell filled before) touches a single cache line. The coarse plots are
+ * projected from it at write time.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TH1;
+
+/**
+ * \class SparseHist
+ * \brief An N-dimensional histogram storing only filled cells.
+ *
+ * Axes have uniform bins, with an underflow (0) and overflow (nbins + 1)
+ * bin each, as in ROOT.
+ *
+ * \param _nbins Number of bins, per axis
+ * \param _min Lower edges, per axis
+ * \param _max Upper edges, per axis
+ */
+class SparseHist {
+public:
+  SparseHist(const std::vector<int>& _nbins, const std::vector<double>& _min,
+             const std::vector<double>& _max);
+
+  /** Add a weight at a point (one coordinate per axis). */
+  void Fill(const double* x, double w);
+
+  /** Add the contents of another histogram with the same axes. */
+  void Merge(const SparseHist& other);
+
+  /** Empty the histogram. */
+  void Reset();
+
+  /** Number of filled cells. */
+  size_t size() const { return nfilled; }
+
+  /** Number of fills. */
+  double GetEntries() const { return nentries; }
+
+  /**
+   * Project onto a 1D or 2D histogram, summing the cells whose centers
+   * fall in each of its bins (underflow/overflow cells go to the
+   * underflow/overflow bins). The fine bins should subdivide the bins of
+   * hist. hist is reset first; its errors are from the sums of w^2.
+   *
+   * \param hist Histogram to fill
+   * \param axes The axes mapped to hist's x (and y)
+   */
+  void Project(TH1* hist, const std::vector<int>& axes) const;
+
+  /** Write as a THnSparseD, e.g. for later projections with other binnings. */
+  void Write(const std::string& name, const std::string& title) const;
+
+private:
+  /** A filled cell. */
+  struct Cell {
+    uint64_t key;  //!< Global cell index + 1 (0 marks an empty slot)
+    double sumw;  //!< Sum of weights
+    double sumw2;  //!< Sum of squared weights
+  };
+
+  /** The cell for a key, inserted if new. */
+  Cell& Find(uint64_t key);
+
+  /** Double the table size. */
+  void Grow();
+
+  /** Coordinate of bin i on an axis: its center, or outside the range for under/overflow. */
+  double Coordinate(size_t axis, int i) const;
+
+  std::vector<int> nbins;  //!< Bins per axis
+  std::vector<double> min;  //!< Lower edges
+  std::vector<double> max;  //!< Upper edges
+  std::vector<uint64_t> stride;  //!< Global index stride per axis
+  std::vector<Cell> cells;  //!< Hash table, size a power of 2
+  size_t nfilled;  //!< Number of filled cells
+  double nentries;  //!< Number of fills
+};
+
+#endif  // __SPARSEHIST__
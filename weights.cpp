@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include "TH1.h"
+#include "weights.h"
+
+namespace {
+
+  // Poisson(1) cumulative probabilities, scaled to 2^32
+  const uint64_t kPoissonCDF[] = {
+    1580030168ULL, 3160060337ULL, 3950075421ULL, 4213413783ULL,
+    4279248373ULL, 4292415291ULL, 4294609777ULL, 4294923276ULL,
+    4294962463ULL, 4294966817ULL, 4294967252ULL, 4294967292ULL
+  };
+
+  // SplitMix64 finalizer: a cheap counter-based generator
+  uint64_t Mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+}  // namespace
+
+
+Slicer::Slicer(const std::string& _variable, const std::vector<double>& _values)
+    : variable(_variable), values(_values) {}
+
+
+Slicer* Slicer::Parse(const std::string& spec) {
+  size_t colon = spec.find(':');
+  if (colon == std::string::npos) {
+    return nullptr;
+  }
+  std::string variable = spec.substr(0, colon);
+
+  std::vector<double> values;
+  std::stringstream ss(spec.substr(colon + 1));
+  std::string value;
+  while (std::getline(ss, value, ',')) {
+    values.push_back(std::atof(value.c_str()));
+  }
+
+  if (variable == "Enu_true" && values.size() >= 2 && std::is_sorted(values.begin(), values.end())) {
+    return new Slicer(variable, values);
+  }
+  if (variable == "tgt" && !values.empty()) {
+    return new Slicer(variable, values);
+  }
+  return nullptr;
+}
+
+
+size_t Slicer::Slice(const NuisTree& nuistr) const {
+  if (variable == "tgt") {
+    return std::find(values.begin(), values.end(), nuistr.tgt) - values.begin();
+  }
+  if (nuistr.Enu_true < values.front() || nuistr.Enu_true >= values.back()) {
+    return size();
+  }
+  return std::upper_bound(values.begin(), values.end(), nuistr.Enu_true) - values.begin() - 1;
+}
+
+
+std::string Slicer::Label(size_t k) const {
+  std::stringstream ss;
+  if (variable == "tgt") {
+    ss << "tgt = " << (long long)values[k];
+  }
+  else {
+    ss << values[k] << " < E_{#nu} < " << values[k+1] << " GeV";
+  }
+  return ss.str();
+}
+
+
+EventWeights::EventWeights(size_t _nuniverses, const std::vector<std::string>& _sets,
+                           size_t _nreplicas, const Slicer* _slicer)
+    : nuniverses(_nuniverses), sets(_sets), nreplicas(_nreplicas),
+      slicer(_slicer), slice(0), terms(_sets.size()),
+      w(_nuniverses + 2 * _sets.size() + _nreplicas + (_slicer ? 2 : 0)) {
+  for (size_t k=0; k<sets.size(); k++) {
+    if (!ParseSet(sets[k], terms[k])) {
+      throw std::invalid_argument("EventWeights: bad weight set " + sets[k]);
+    }
+  }
+}
+
+
+bool EventWeights::ParseSet(const std::string& expr, std::vector<float NuisTree::*>& terms) {
+  terms.clear();
+  std::stringstream ss(expr);
+  std::string name;
+  while (std::getline(ss, name, '*')) {
+    if (name == "Weight") terms.push_back(&NuisTree::Weight);
+    else if (name == "InputWeight") terms.push_back(&NuisTree::InputWeight);
+    else if (name == "RWWeight") terms.push_back(&NuisTree::RWWeight);
+    else if (name == "CustomWeight") terms.push_back(&NuisTree::CustomWeight);
+    else return false;
+  }
+  return !terms.empty();
+}
+
+
+int EventWeights::PoissonCount(uint64_t key, size_t b) {
+  uint64_t u = Mix(Mix(key) + b) >> 32;
+  int k = 0;
+  while (k < 12 && u >= kPoissonCDF[k]) {
+    k++;
+  }
+  return k;
+}
+
+
+void EventWeights::Set(const NuisTree& nuistr, uint64_t key) {
+  for (size_t u=0; u<nuniverses; u++) {
+    w[u] = nuistr.Weight * nuistr.CustomWeightArray[u];
+  }
+
+  for (size_t k=0; k<terms.size(); k++) {
+    float wk = 1;
+    for (float NuisTree::* term : terms[k]) {
+      wk *= nuistr.*term;
+    }
+    w[SetChannel(k)] = wk;
+    w[SetChannel(k) + 1] = wk * wk;
+  }
+
+  float* replica = w.data() + ReplicaChannel();
+  for (size_t b=0; b<nreplicas; b++) {
+    replica[b] = nuistr.Weight * PoissonCount(key, b);
+  }
+
+  if (slicer) {
+    slice = slicer->Slice(nuistr);
+    w[NominalChannel()] = nuistr.Weight;
+    w[NominalChannel() + 1] = nuistr.Weight * nuistr.Weight;
+  }
+}
+
+
+WeightChannels::WeightChannels(size_t _nbins, size_t _nchannels, size_t _nslices)
+    : nbins(_nbins), nchannels(_nchannels), nslices(_nslices),
+      storage(_nslices * _nbins * _nchannels, 0), sums(storage.data()), inarena(false) {}
+
+
+WeightChannels::WeightChannels(double* _sums, size_t _nbins, size_t _nchannels, size_t _nslices)
+    : nbins(_nbins), nchannels(_nchannels), nslices(_nslices), sums(_sums), inarena(true) {}
+
+
+void WeightChannels::Merge(const WeightChannels& other) {
+  for (size_t i=0; i<size(); i++) {
+    sums[i] += other.sums[i];
+  }
+}
+
+
+std::vector<double> WeightChannels::GetSums(int slice) const {
+  size_t n = nbins * nchannels;
+  if (slice >= 0) {
+    return std::vector<double>(sums + slice * n, sums + (slice + 1) * n);
+  }
+
+  std::vector<double> s(n, 0);
+  for (size_t k=0; k<nslices; k++) {
+    for (size_t i=0; i<n; i++) {
+      s[i] += sums[k * n + i];
+    }
+  }
+  return s;
+}
+
+
+void WeightChannels::WriteSpread(const TH1* hist, const std::string& name,
+                                 const std::string& title, const std::vector<double>& s,
+                                 size_t first, size_t n) const {
+  std::unique_ptr<TH1> hmean((TH1*)hist->Clone((name + "_mean").c_str()));
+  std::unique_ptr<TH1> hrms((TH1*)hist->Clone((name + "_rms").c_str()));
+  hmean->Reset();
+  hrms->Reset();
+  hmean->SetTitle(title.c_str());
+  hrms->SetTitle(title.c_str());
+
+  for (size_t bin=0; bin<nbins; bin++) {
+    const double* row = s.data() + bin * nchannels + first;
+    double sum = 0, sum2 = 0;
+    for (size_t c=0; c<n; c++) {
+      sum += row[c];
+      sum2 += row[c] * row[c];
+    }
+    double mean = sum / n;
+    double rms = std::sqrt(std::max(0.0, sum2 / n - mean * mean));
+    hmean->SetBinContent(bin, mean);
+    hmean->SetBinError(bin, rms);
+    hrms->SetBinContent(bin, rms);
+  }
+  hmean->SetEntries(hist->GetEntries());
+  hrms->SetEntries(hist->GetEntries());
+
+  std::cout << "WRITE " << hmean->GetName() << std::endl;
+  hmean->Write();
+  std::cout << "WRITE " << hrms->GetName() << std::endl;
+  hrms->Write();
+}
+
+
+void WeightChannels::WriteChannel(const TH1* hist, const std::string& name,
+                                  const std::string& title, const std::vector<double>& s,
+                                  size_t channel) const {
+  std::unique_ptr<TH1> h((TH1*)hist->Clone(name.c_str()));
+  h->Reset();
+  h->SetTitle(title.c_str());
+
+  for (size_t bin=0; bin<nbins; bin++) {
+    const double* row = s.data() + bin * nchannels + channel;
+    h->SetBinContent(bin, row[0]);
+    h->SetBinError(bin, std::sqrt(row[1]));
+  }
+  h->SetEntries(hist->GetEntries());
+
+  std::cout << "WRITE " << h->GetName() << std::endl;
+  h->Write();
+}
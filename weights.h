@@ -0,0 +1,218 @@
+#ifndef __WEIGHTS__
+#define __WEIGHTS__
+
+/**
+ * Weight channels: several weights per event, filled into the same bins.
+ *
+ * For systematic bands each event carries one weight per universe
+ * (NUISANCE's CustomWeightArray), and the same plots are often wanted
+ * under each of the tree's weight branches (weight sets). Rather than
+ * rerunning the plotter for each, the weights of the current event are
+ * computed once (EventWeights) and every distribution adds them to a
+ * bin-major buffer (WeightChannels), where all the channels of one bin sit
+ * next to each other. A fill finds the bin once and then adds the whole row
+ * of weights.
+ *
+ * Each buffer can be split into slices of Enu_true or tgt (Slicer): the
+ * slice of an event is found once, and the fill goes to that slice's bins.
+ *
+ * The same buffer holds Poisson bootstrap replicas for MC statistical
+ * uncertainties that account for the weights: replica b weights each event
+ * by a Poisson(1) count, drawn from a counter-based generator keyed on the
+ * event's entry, so results do not depend on the number of threads.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "NuisTree.h"
+
+class TH1;
+
+/**
+ * \class Slicer
+ * \brief Splits events into slices of Enu_true or tgt.
+ *
+ * Slices of Enu_true are given by bin edges, slices of tgt by the target
+ * PDG codes, one per slice.
+ *
+ * \param _variable "Enu_true" or "tgt"
+ * \param _values Enu_true edges (GeV) or tgt codes
+ */
+class Slicer {
+public:
+  Slicer(const std::string& _variable, const std::vector<double>& _values);
+
+  /**
+   * Parse a slicing, "VARIABLE:V1,V2,..." (e.g. "Enu_true:0,0.5,1,2" or
+   * "tgt:1000060120,1000180400"). Returns nullptr if it is not valid.
+   */
+  static Slicer* Parse(const std::string& spec);
+
+  /** Number of slices. */
+  size_t size() const { return variable == "tgt" ? values.size() : values.size() - 1; }
+
+  /** Slice of an event, or size() if it is in none. */
+  size_t Slice(const NuisTree& nuistr) const;
+
+  /** Description of a slice, for titles. */
+  std::string Label(size_t k) const;
+
+  std::string variable;  //!< Variable to slice on
+  std::vector<double> values;  //!< Edges or target codes
+};
+
+
+/**
+ * \class EventWeights
+ * \brief The channel weights of the current event.
+ *
+ * The first nuniverses channels are the universes: channel u is the event
+ * weight times CustomWeightArray[u]. Each weight set then takes two
+ * channels, its weight and the weight squared (for the errors). A weight
+ * set is a product of weight branches, e.g. "InputWeight*RWWeight". The
+ * bootstrap replicas follow. With a slicer, two more channels hold the
+ * nominal weight and its square, for the sliced copies of the histogram.
+ *
+ * \param _nuniverses Number of universes
+ * \param _sets Weight set expressions
+ * \param _nreplicas Number of bootstrap replicas
+ * \param _slicer Slicing, or nullptr
+ */
+class EventWeights {
+public:
+  EventWeights(size_t _nuniverses=0, const std::vector<std::string>& _sets={},
+               size_t _nreplicas=0, const Slicer* _slicer=nullptr);
+
+  /**
+   * Parse a weight set expression: weight branch names (Weight,
+   * InputWeight, RWWeight, CustomWeight) joined by "*". Returns false if
+   * the expression is not valid.
+   */
+  static bool ParseSet(const std::string& expr, std::vector<float NuisTree::*>& terms);
+
+  /** First channel of weight set k. */
+  size_t SetChannel(size_t k) const { return nuniverses + 2 * k; }
+
+  /** First bootstrap replica channel. */
+  size_t ReplicaChannel() const { return nuniverses + 2 * sets.size(); }
+
+  /** Nominal weight channel, with a slicer. */
+  size_t NominalChannel() const { return ReplicaChannel() + nreplicas; }
+
+  /** Number of slices in the channel buffers (the last collects events in no slice). */
+  size_t NSlices() const { return slicer ? slicer->size() + 1 : 1; }
+
+  /**
+   * Compute the channel weights and slice for an event.
+   *
+   * \param nuistr The event
+   * \param key Unique and reproducible event key (e.g. file and entry number), seeding the bootstrap
+   */
+  void Set(const NuisTree& nuistr, uint64_t key=0);
+
+  /** Poisson(1) count for replica b of the event with the given key. */
+  static int PoissonCount(uint64_t key, size_t b);
+
+  /** Number of channels. */
+  size_t size() const { return w.size(); }
+
+  /** Weights of the current event, one per channel. */
+  const float* data() const { return w.data(); }
+
+  size_t nuniverses;  //!< Number of universes
+  std::vector<std::string> sets;  //!< Weight set expressions
+  size_t nreplicas;  //!< Number of bootstrap replicas
+  const Slicer* slicer;  //!< Slicing, or nullptr
+  size_t slice;  //!< Slice of the current event
+
+private:
+  std::vector<std::vector<float NuisTree::*> > terms;  //!< Weight set factors
+  std::vector<float> w;  //!< Channel weights
+};
+
+
+/**
+ * \class WeightChannels
+ * \brief Per-bin sums of weights for each channel, bin-major.
+ *
+ * With slices, each slice holds its own bins: the buffer is
+ * [slice][bin][channel]. As with BinSums, the buffer is either owned or a
+ * view into a BinArena.
+ *
+ * \param _nbins Number of histogram cells (including under/overflow)
+ * \param _nchannels Number of channels
+ * \param _nslices Number of slices
+ */
+class WeightChannels {
+public:
+  /** Channels owning their buffer. */
+  WeightChannels(size_t _nbins, size_t _nchannels, size_t _nslices=1);
+
+  /**
+   * Channels in an external buffer of size() zeroed sums, e.g. in a
+   * BinArena.
+   */
+  WeightChannels(double* _sums, size_t _nbins, size_t _nchannels, size_t _nslices);
+
+  WeightChannels(const WeightChannels&) = delete;
+  WeightChannels& operator=(const WeightChannels&) = delete;
+
+  /** Add one event's channel weights to a bin of a slice. */
+  void Fill(int slice, int bin, const float* w) {
+    double* s = sums + (slice * nbins + bin) * nchannels;
+    for (size_t c=0; c<nchannels; c++) {
+      s[c] += w[c];
+    }
+  }
+
+  /** Add the sums of another copy. */
+  void Merge(const WeightChannels& other);
+
+  /** Number of sums in the buffer. */
+  size_t size() const { return nslices * nbins * nchannels; }
+
+  /** True if the buffer is held by a BinArena. */
+  bool InArena() const { return inarena; }
+
+  /** Sums of one slice, or of all slices if slice < 0, as [bin][channel]. */
+  std::vector<double> GetSums(int slice) const;
+
+  /**
+   * Write the per-bin mean and RMS over a range of channels, as histograms
+   * shaped like hist: "<name>_mean", with the RMS as errors, and
+   * "<name>_rms".
+   *
+   * \param hist Histogram the channels were filled alongside
+   * \param name Name prefix
+   * \param title Title
+   * \param s Sums, from GetSums
+   * \param first First channel
+   * \param n Number of channels
+   */
+  void WriteSpread(const TH1* hist, const std::string& name, const std::string& title,
+                   const std::vector<double>& s, size_t first, size_t n) const;
+
+  /**
+   * Write one channel as a histogram shaped like hist, with the errors from
+   * the next channel's sum of squared weights.
+   *
+   * \param hist Histogram the channels were filled alongside
+   * \param name Name
+   * \param title Title
+   * \param s Sums, from GetSums
+   * \param channel Channel holding the weights
+   */
+  void WriteChannel(const TH1* hist, const std::string& name, const std::string& title,
+                    const std::vector<double>& s, size_t channel) const;
+
+private:
+  size_t nbins;  //!< Number of cells
+  size_t nchannels;  //!< Number of channels
+  size_t nslices;  //!< Number of slices
+  std::vector<double> storage;  //!< Owned buffer (empty for external storage)
+  double* sums;  //!< Sums, [slice][bin][channel]
+  bool inarena;  //!< Buffer is in external storage
+};
+
+#endif  // __WEIGHTS__
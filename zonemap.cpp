@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "TFile.h"
+#include "TTree.h"
+#include "NuisTree.h"
+#include "filter.h"
+#include "zonemap.h"
+
+namespace {
+
+  // Add a value to a capped list of distinct values
+  void AddDistinct(int value, int& n, int* values) {
+    if (n < 0 || std::find(values, values + n, value) != values + n) {
+      return;
+    }
+    if (n == Zone::kMaxDistinct) {
+      n = -1;
+      return;
+    }
+    values[n++] = value;
+  }
+
+}  // namespace
+
+
+Zone::Zone(Long64_t _first, Long64_t _last)
+    : first(_first), last(_last), modemin(0), modemax(-1), nmodes(0),
+      pdgnumin(0), pdgnumax(-1), npdgnu(0), ccmin(1), ccmax(0),
+      enumin(0), enumax(-1) {}
+
+
+void Zone::Add(const NuisTree& nuistr) {
+  bool empty = (modemax < modemin);
+  modemin = empty ? nuistr.Mode : std::min(modemin, nuistr.Mode);
+  modemax = empty ? nuistr.Mode : std::max(modemax, nuistr.Mode);
+  pdgnumin = empty ? nuistr.PDGnu : std::min(pdgnumin, nuistr.PDGnu);
+  pdgnumax = empty ? nuistr.PDGnu : std::max(pdgnumax, nuistr.PDGnu);
+  ccmin = std::min(ccmin, (int)(bool)nuistr.iscc);
+  ccmax = std::max(ccmax, (int)(bool)nuistr.iscc);
+  enumin = empty ? nuistr.Enu_true : std::min(enumin, nuistr.Enu_true);
+  enumax = empty ? nuistr.Enu_true : std::max(enumax, nuistr.Enu_true);
+  AddDistinct(nuistr.Mode, nmodes, modes);
+  AddDistinct(nuistr.PDGnu, npdgnu, pdgnu);
+}
+
+
+bool Zone::HasMode(int mode) const {
+  if (nmodes < 0) {
+    return modemin <= mode && mode <= modemax;
+  }
+  return std::find(modes, modes + nmodes, mode) != modes + nmodes;
+}
+
+
+bool Zone::HasPDGnu(int pdg) const {
+  if (npdgnu < 0) {
+    return pdgnumin <= pdg && pdg <= pdgnumax;
+  }
+  return std::find(pdgnu, pdgnu + npdgnu, pdg) != pdgnu + npdgnu;
+}
+
+
+ZoneMap::ZoneMap(const std::string& _filename)
+    : filename(_filename), complete(false) {
+  // Inputs written by reorder_nuistr carry their own bucket directory
+  {
+    TFile fin(filename.c_str(), "READ");
+    uuid = fin.GetUUID().AsString();
+    TTree* buckets = (TTree*)fin.Get("buckets");
+    if (buckets) {
+      Read(buckets);
+      std::cout << "ZONES " << filename << ": " << zones.size() << " buckets" << std::endl;
+      return;
+    }
+  }
+
+  std::string sidecar = SidecarName(filename);
+  if (!std::ifstream(sidecar)) {
+    return;
+  }
+
+  std::unique_ptr<TFile> side(TFile::Open(sidecar.c_str(), "READ"));
+  if (!side || side->IsZombie()) {
+    return;
+  }
+
+  TTree* tree = (TTree*)side->Get("zones");
+  if (!tree || uuid != tree->GetTitle()) {
+    return;
+  }
+  Read(tree);
+
+  std::cout << "ZONES " << filename << ": " << zones.size() << " zones" << std::endl;
+}
+
+
+void ZoneMap::Read(TTree* tree) {
+  Zone zone;
+  tree->SetBranchAddress("first", &zone.first);
+  tree->SetBranchAddress("last", &zone.last);
+  tree->SetBranchAddress("modemin", &zone.modemin);
+  tree->SetBranchAddress("modemax", &zone.modemax);
+  tree->SetBranchAddress("nmodes", &zone.nmodes);
+  tree->SetBranchAddress("modes", zone.modes);
+  tree->SetBranchAddress("pdgnumin", &zone.pdgnumin);
+  tree->SetBranchAddress("pdgnumax", &zone.pdgnumax);
+  tree->SetBranchAddress("npdgnu", &zone.npdgnu);
+  tree->SetBranchAddress("pdgnu", zone.pdgnu);
+  tree->SetBranchAddress("ccmin", &zone.ccmin);
+  tree->SetBranchAddress("ccmax", &zone.ccmax);
+  tree->SetBranchAddress("enumin", &zone.enumin);
+  tree->SetBranchAddress("enumax", &zone.enumax);
+  for (Long64_t i=0; i<tree->GetEntries(); i++) {
+    tree->GetEntry(i);
+    zones.push_back(zone);
+  }
+  complete = true;
+}
+
+
+std::string ZoneMap::SidecarName(const std::string& filename) {
+  return filename + ".zonemap.root";
+}
+
+
+std::vector<std::pair<Long64_t, Long64_t> >
+ZoneMap::Restrict(const std::vector<std::pair<Long64_t, Long64_t> >& clusters,
+                  const std::vector<Filter*>& filters) const {
+  // Entry ranges that some filter might pass
+  std::vector<std::pair<Long64_t, Long64_t> > live;
+  for (const Zone& zone : zones) {
+    for (Filter* filter : filters) {
+      if (filter->CanPass(zone)) {
+        live.push_back(std::make_pair(zone.first, zone.last));
+        break;
+      }
+    }
+  }
+
+  std::vector<std::pair<Long64_t, Long64_t> > restricted;
+  Long64_t nskipped = 0;
+  for (const auto& cluster : clusters) {
+    bool keep = false;
+    for (const auto& range : live) {
+      if (range.first < cluster.second && range.second > cluster.first) {
+        keep = true;
+        break;
+      }
+    }
+    if (keep) {
+      restricted.push_back(cluster);
+    }
+    else {
+      nskipped += cluster.second - cluster.first;
+    }
+  }
+
+  std::cout << "ZONES " << filename << ": skipping " << nskipped << " entries" << std::endl;
+
+  return restricted;
+}
+
+
+void ZoneMap::Add(const Zone& zone) {
+  std::lock_guard<std::mutex> lock(mutex);
+  zones.push_back(zone);
+}
+
+
+void ZoneMap::Write() {
+  std::sort(zones.begin(), zones.end(),
+            [](const Zone& a, const Zone& b) { return a.first < b.first; });
+
+  std::string sidecar = SidecarName(filename);
+  TFile side(sidecar.c_str(), "RECREATE");
+  if (side.IsZombie()) {
+    std::cout << "Warning: cannot write zone map to " << sidecar << std::endl;
+    return;
+  }
+
+  WriteZones(zones, "zones", uuid);
+  side.Close();
+
+  std::cout << "ZONES " << filename << ": wrote " << zones.size()
+            << " zones to " << sidecar << std::endl;
+}
+
+
+void ZoneMap::WriteZones(const std::vector<Zone>& zones, const std::string& name,
+                         const std::string& title) {
+  // The tree belongs to the current directory, which deletes it on closing
+  Zone zone;
+  std::string distinct = "[" + std::to_string(Zone::kMaxDistinct) + "]/I";
+  TTree* tree = new TTree(name.c_str(), title.c_str());
+  tree->Branch("first", &zone.first, "first/L");
+  tree->Branch("last", &zone.last, "last/L");
+  tree->Branch("modemin", &zone.modemin, "modemin/I");
+  tree->Branch("modemax", &zone.modemax, "modemax/I");
+  tree->Branch("nmodes", &zone.nmodes, "nmodes/I");
+  tree->Branch("modes", zone.modes, ("modes" + distinct).c_str());
+  tree->Branch("pdgnumin", &zone.pdgnumin, "pdgnumin/I");
+  tree->Branch("pdgnumax", &zone.pdgnumax, "pdgnumax/I");
+  tree->Branch("npdgnu", &zone.npdgnu, "npdgnu/I");
+  tree->Branch("pdgnu", zone.pdgnu, ("pdgnu" + distinct).c_str());
+  tree->Branch("ccmin", &zone.ccmin, "ccmin/I");
+  tree->Branch("ccmax", &zone.ccmax, "ccmax/I");
+  tree->Branch("enumin", &zone.enumin, "enumin/F");
+  tree->Branch("enumax", &zone.enumax, "enumax/F");
+  for (const Zone& z : zones) {
+    zone = z;
+    tree->Fill();
+  }
+  tree->Write();
+}
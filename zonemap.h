@@ -0,0 +1,118 @@
+#ifndef __ZONEMAP__
+#define __ZONEMAP__
+
+/**
+ * Per-cluster summaries of the event fields the filters select on.
+ *
+ * NUISANCE files are often written in generator order, so Mode and PDGnu
+ * come in long runs. A zone map records, for each range of entries read as
+ * one task (one or more TTree clusters), the range and the distinct values
+ * of Mode, PDGnu, cc and Enu_true. Filters can then rule out whole zones
+ * (see Filter::CanPass) and those entries are never read. Zone maps are
+ * kept in a sidecar file next to the input (INPUT.root.zonemap.root),
+ * tagged with the UUID of the input.
+ *
+ * Files written by reorder_nuistr hold their events grouped into buckets
+ * of one (PDGnu, cc, GENIE mode), with the zone of each bucket stored in a
+ * "buckets" tree in the file itself; this is used in place of a sidecar.
+ */
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Rtypes.h"
+
+class Filter;
+class NuisTree;
+class TTree;
+
+/**
+ * \class Zone
+ * \brief Summary of the events in one entry range.
+ *
+ * Distinct values are kept for Mode and PDGnu while there are at most
+ * kMaxDistinct of them; past that only the min/max is used.
+ */
+struct Zone {
+  static const int kMaxDistinct = 32;
+
+  Zone(Long64_t _first=0, Long64_t _last=0);
+
+  /** Include an event in the summary. */
+  void Add(const NuisTree& nuistr);
+
+  /** Could the zone hold an event with this Mode? */
+  bool HasMode(int mode) const;
+
+  /** Could the zone hold an event with this neutrino PDG code? */
+  bool HasPDGnu(int pdg) const;
+
+  /** Could the zone hold a CC (or NC) event? */
+  bool HasCC(bool cc) const { return ccmin <= cc && cc <= ccmax; }
+
+  /** Could the zone hold an event with Enu_true in [emin, emax]? */
+  bool HasEnu(float emin, float emax) const { return enumin <= emax && enumax >= emin; }
+
+  Long64_t first;  //!< First entry
+  Long64_t last;  //!< One past the last entry
+  int modemin;  //!< Smallest Mode
+  int modemax;  //!< Largest Mode
+  int nmodes;  //!< Number of distinct modes, or -1 if more than kMaxDistinct
+  int modes[kMaxDistinct];  //!< Distinct modes
+  int pdgnumin;  //!< Smallest PDGnu
+  int pdgnumax;  //!< Largest PDGnu
+  int npdgnu;  //!< Number of distinct PDGnu, or -1 if more than kMaxDistinct
+  int pdgnu[kMaxDistinct];  //!< Distinct PDGnu
+  int ccmin;  //!< Smallest cc flag
+  int ccmax;  //!< Largest cc flag
+  float enumin;  //!< Smallest Enu_true
+  float enumax;  //!< Largest Enu_true
+};
+
+
+/**
+ * \class ZoneMap
+ * \brief Zone summaries for one input file.
+ *
+ * \param _filename Input NUISANCE file name
+ */
+class ZoneMap {
+public:
+  ZoneMap(const std::string& _filename);
+
+  /** Sidecar file name for an input file. */
+  static std::string SidecarName(const std::string& filename);
+
+  /** True if a zone map or bucket directory was found for this input. */
+  bool IsComplete() const { return complete; }
+
+  /**
+   * Drop the clusters lying entirely in zones that none of the filters
+   * can pass (if complete).
+   */
+  std::vector<std::pair<Long64_t, Long64_t> >
+  Restrict(const std::vector<std::pair<Long64_t, Long64_t> >& clusters,
+           const std::vector<Filter*>& filters) const;
+
+  /** Record the summary of a range read in full. Thread safe. */
+  void Add(const Zone& zone);
+
+  /** Write the recorded zones to the sidecar file. */
+  void Write();
+
+  /** Write zones as a tree in the current directory. */
+  static void WriteZones(const std::vector<Zone>& zones, const std::string& name,
+                         const std::string& title);
+
+private:
+  void Read(TTree* tree);
+
+  std::string filename;  //!< Input file name
+  std::string uuid;  //!< UUID of the input file
+  bool complete;  //!< A zone map was found
+  std::vector<Zone> zones;  //!< Zones, ordered by first entry
+  std::mutex mutex;
+};
+
+#endif  // __ZONEMAP__